@@ -5,54 +5,418 @@
 #include <random>
 #include <cstdlib>
 #include <cassert>
+#include <cstring>
+#include <cstdint>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <array>
+#include <tuple>
+#include <utility>
+#include <map>
+#include <list>
+#include <bit>
+#include <fstream>
+#include <string>
+#include <limits>
+#include <optional>
+#include <memory_resource>
+#include <unordered_map>
+#include <string_view>
+#include <charconv>
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <unistd.h>
+#define POOL_HAS_MMAP 1
+#endif
+#ifdef __linux__
+#include <sys/syscall.h>
+#if __has_include(<linux/perf_event.h>)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#define POOL_HAS_PERF_EVENTS 1
+#endif
+#endif
 using namespace std;
 
+inline size_t pageSize() {
+#ifdef POOL_HAS_MMAP
+    static const size_t size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    return size;
+#else
+    return 4096;
+#endif
+}
+
+struct PageOptions {
+    bool hugePages = false;       // MAP_HUGETLB if pages are reserved, else transparent huge pages
+    bool bindLocalNode = false;   // prefer the NUMA node of the thread that maps the memory
+};
+
+inline size_t hugePageSize() {
+    static const size_t size = [] {
+        ifstream meminfo("/proc/meminfo");
+        string key;
+        size_t kilobytes = 0;
+        while (meminfo >> key) {
+            if (key == "Hugepagesize:" && meminfo >> kilobytes) {
+                return kilobytes * 1024;
+            }
+            meminfo.ignore(numeric_limits<streamsize>::max(), '\n');
+        }
+        return static_cast<size_t>(2) << 20;
+    }();
+    return size;
+}
+
+// NUMA node of the CPU the calling thread is running on, or -1 if unknown.
+inline int currentNumaNode() {
+#if defined(__linux__) && defined(SYS_getcpu)
+    unsigned cpu = 0, node = 0;
+    if (syscall(SYS_getcpu, &cpu, &node, nullptr) == 0) {
+        return static_cast<int>(node);
+    }
+#endif
+    return -1;
+}
+
+// Source of the large, aligned regions behind MemoryPool chunks and
+// LinearAllocator buffers. Every option degrades quietly: without reserved
+// huge pages it asks for transparent ones, without THP it keeps 4 KB pages,
+// and without mbind the memory simply stays unbound.
+class PageProvider {
+public:
+    struct Stats {
+        size_t mappings;
+        size_t hugetlbMappings;     // backed by reserved huge pages
+        size_t transparentMappings; // advised for transparent huge pages
+        size_t boundMappings;       // bound to the local NUMA node
+    };
+    
+private:
+    PageOptions options;
+    Stats stats;
+    
+#ifdef POOL_HAS_MMAP
+    // Over-maps, then gives back the misaligned head and the unused tail.
+    static void* mapWithFlags(size_t mapped, size_t alignment, int extraFlags) {
+        void* raw = mmap(nullptr, mapped + alignment, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | extraFlags, -1, 0);
+        if (raw == MAP_FAILED) {
+            return nullptr;
+        }
+        
+        uintptr_t start = reinterpret_cast<uintptr_t>(raw);
+        uintptr_t aligned = (start + alignment - 1) & ~(alignment - 1);
+        uintptr_t end = start + mapped + alignment;
+        if (aligned > start) {
+            munmap(raw, aligned - start);
+        }
+        if (end > aligned + mapped) {
+            munmap(reinterpret_cast<void*>(aligned + mapped), end - aligned - mapped);
+        }
+        return reinterpret_cast<void*>(aligned);
+    }
+    
+    // Must run before the pages are first touched; afterwards they are already placed.
+    static bool bindToLocalNode(void* ptr, size_t bytes) {
+#if defined(__linux__) && defined(SYS_mbind)
+        constexpr int MPOL_PREFERRED_MODE = 1;
+        int node = currentNumaNode();
+        if (node < 0 || node >= static_cast<int>(sizeof(unsigned long) * 8)) {
+            return false;
+        }
+        unsigned long nodeMask = 1UL << node;
+        return syscall(SYS_mbind, ptr, bytes, MPOL_PREFERRED_MODE, &nodeMask,
+                       sizeof(nodeMask) * 8, 0) == 0;
+#else
+        (void)ptr;
+        (void)bytes;
+        return false;
+#endif
+    }
+#endif
+    
+public:
+    explicit PageProvider(PageOptions opts = {}) : options(opts), stats{} {}
+    
+    // Mappings are made in multiples of this, so callers can size regions to use it fully.
+    size_t granularity() const {
+        return options.hugePages ? hugePageSize() : pageSize();
+    }
+    
+    size_t roundUp(size_t bytes) const {
+        return (bytes + granularity() - 1) & ~(granularity() - 1);
+    }
+    
+    void* map(size_t bytes, size_t alignment) {
+#ifdef POOL_HAS_MMAP
+        size_t mapped = roundUp(bytes);
+        alignment = max(alignment, granularity());
+        
+        void* ptr = nullptr;
+#ifdef MAP_HUGETLB
+        if (options.hugePages && (ptr = mapWithFlags(mapped, alignment, MAP_HUGETLB))) {
+            ++stats.hugetlbMappings;
+        }
+#endif
+        if (!ptr) {
+            ptr = mapWithFlags(mapped, alignment, 0);
+            if (!ptr) {
+                throw bad_alloc();
+            }
+#ifdef MADV_HUGEPAGE
+            if (options.hugePages && madvise(ptr, mapped, MADV_HUGEPAGE) == 0) {
+                ++stats.transparentMappings;
+            }
+#endif
+        }
+        
+        if (options.bindLocalNode && bindToLocalNode(ptr, mapped)) {
+            ++stats.boundMappings;
+        }
+        ++stats.mappings;
+        return ptr;
+#else
+        ++stats.mappings;
+        return ::operator new(bytes, align_val_t(alignment));
+#endif
+    }
+    
+    // Pages go straight back to the OS rather than to malloc's heap.
+    void unmap(void* ptr, size_t bytes, size_t alignment) {
+#ifdef POOL_HAS_MMAP
+        (void)alignment;
+        munmap(ptr, roundUp(bytes));
+#else
+        (void)bytes;
+        ::operator delete(ptr, align_val_t(alignment));
+#endif
+    }
+    
+    const PageOptions& getOptions() const { return options; }
+    Stats getStats() const { return stats; }
+};
+
+// Resident set size of this process, or 0 where /proc is unavailable.
+inline size_t residentBytes() {
+    ifstream statm("/proc/self/statm");
+    size_t totalPages = 0, residentPages = 0;
+    if (statm >> totalPages >> residentPages) {
+        return residentPages * pageSize();
+    }
+    return 0;
+}
+
+// Counts data-TLB load misses of the calling thread through perf_event_open.
+// available() is false on kernels or containers that do not expose the counter.
+class TlbMissCounter {
+private:
+    int fd = -1;
+    
+public:
+    TlbMissCounter() {
+#ifdef POOL_HAS_PERF_EVENTS
+        perf_event_attr attr{};
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HW_CACHE;
+        attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                      (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+#endif
+    }
+    
+    ~TlbMissCounter() {
+#ifdef POOL_HAS_MMAP
+        if (fd >= 0) close(fd);
+#endif
+    }
+    
+    TlbMissCounter(const TlbMissCounter&) = delete;
+    TlbMissCounter& operator=(const TlbMissCounter&) = delete;
+    
+    bool available() const { return fd >= 0; }
+    
+    void start() {
+#ifdef POOL_HAS_PERF_EVENTS
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+    }
+    
+    uint64_t stop() {
+        uint64_t misses = 0;
+#ifdef POOL_HAS_PERF_EVENTS
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+            if (read(fd, &misses, sizeof(misses)) != sizeof(misses)) {
+                misses = 0;
+            }
+        }
+#endif
+        return misses;
+    }
+};
+
 template<typename T, size_t PoolSize = 1024>
 class MemoryPool {
 private:
     union Block {
-        T data;
+        alignas(T) unsigned char data[sizeof(T)];
         Block* next;
     };
     
-    Block* freeList;
-    vector<unique_ptr<Block[]>> chunks;
+    // Each chunk is mapped on a boundary of its own (power-of-two) size, so the
+    // header of the chunk owning any block is found by masking the block's address.
+    // Every chunk keeps its own free list and sits on the partial list (some
+    // blocks free), the idle list (all free) or neither (full), so releasing an
+    // idle chunk never has to touch another chunk's blocks.
+    struct ChunkHeader {
+        size_t liveBlocks;
+        Block* freeList;
+        ChunkHeader* prev;
+        ChunkHeader* next;
+        size_t index;             // position in chunks
+    };
+    
+    static constexpr size_t HEADER_BYTES = (sizeof(ChunkHeader) + alignof(Block) - 1) / alignof(Block) * alignof(Block);
+    static constexpr size_t CHUNK_BYTES = HEADER_BYTES + PoolSize * sizeof(Block);
+    
+public:
+    struct Stats {
+        size_t chunks;
+        size_t idleChunks;        // chunks with no live blocks, candidates for trim()
+        size_t usedBlocks;
+        size_t totalBlocks;
+        size_t bytesMapped;
+        size_t peakBytesMapped;
+        size_t releasedChunks;    // returned to the OS over the pool's lifetime
+        double utilization;
+        double fragmentation;     // share of free blocks stuck in chunks that still have live blocks
+    };
+    
+private:
+    PageProvider pages;
+    size_t chunkBytes;
     size_t blocksPerChunk;
+    size_t chunkAlignment;
+    uintptr_t chunkMask;
+    ChunkHeader* partialChunks;
+    ChunkHeader* idleList;
+    vector<ChunkHeader*> chunks;
     size_t totalBlocks;
     size_t usedBlocks;
+    size_t idleChunks;
+    size_t idleHighWatermark;
+    size_t peakChunks;
+    size_t releasedChunks;
+    
+    static Block* firstBlock(ChunkHeader* chunk) {
+        return reinterpret_cast<Block*>(reinterpret_cast<char*>(chunk) + HEADER_BYTES);
+    }
+    
+    ChunkHeader* chunkOf(const void* ptr) const {
+        return reinterpret_cast<ChunkHeader*>(reinterpret_cast<uintptr_t>(ptr) & chunkMask);
+    }
+    
+    static void linkChunk(ChunkHeader*& head, ChunkHeader* chunk) {
+        chunk->prev = nullptr;
+        chunk->next = head;
+        if (head) {
+            head->prev = chunk;
+        }
+        head = chunk;
+    }
+    
+    static void unlinkChunk(ChunkHeader*& head, ChunkHeader* chunk) {
+        if (chunk->prev) {
+            chunk->prev->next = chunk->next;
+        } else {
+            head = chunk->next;
+        }
+        if (chunk->next) {
+            chunk->next->prev = chunk->prev;
+        }
+    }
     
     void allocateNewChunk() {
-        auto newChunk = make_unique<Block[]>(blocksPerChunk);
+        ChunkHeader* chunk = static_cast<ChunkHeader*>(pages.map(chunkBytes, chunkAlignment));
+        chunk->liveBlocks = 0;
         
+        Block* blocks = firstBlock(chunk);
         for (size_t i = 0; i < blocksPerChunk - 1; ++i) {
-            newChunk[i].next = &newChunk[i + 1];
+            blocks[i].next = &blocks[i + 1];
         }
-        newChunk[blocksPerChunk - 1].next = freeList;
+        blocks[blocksPerChunk - 1].next = nullptr;
+        chunk->freeList = blocks;
         
-        freeList = newChunk.get();
-        chunks.push_back(move(newChunk));
+        chunk->index = chunks.size();
+        chunks.push_back(chunk);
+        linkChunk(idleList, chunk);
         totalBlocks += blocksPerChunk;
+        ++idleChunks;
+        peakChunks = max(peakChunks, chunks.size());
+    }
+    
+    // Caller has already unlinked the chunk from the idle list.
+    void releaseChunk(ChunkHeader* chunk) {
+        chunks[chunk->index] = chunks.back();
+        chunks[chunk->index]->index = chunk->index;
+        chunks.pop_back();
+        pages.unmap(chunk, chunkBytes, chunkAlignment);
     }
     
 public:
-    MemoryPool() : freeList(nullptr), blocksPerChunk(PoolSize), totalBlocks(0), usedBlocks(0) {
+    // With huge pages a chunk grows to fill whole huge pages, so PoolSize
+    // becomes a lower bound on the blocks per chunk.
+    explicit MemoryPool(PageOptions options = {})
+        : pages(options),
+          chunkBytes(options.hugePages ? pages.roundUp(CHUNK_BYTES) : CHUNK_BYTES),
+          blocksPerChunk((chunkBytes - HEADER_BYTES) / sizeof(Block)),
+          chunkAlignment(max(bit_ceil(chunkBytes), pages.granularity())),
+          chunkMask(~static_cast<uintptr_t>(chunkAlignment - 1)),
+          partialChunks(nullptr), idleList(nullptr), totalBlocks(0), usedBlocks(0),
+          idleChunks(0), idleHighWatermark(4), peakChunks(0), releasedChunks(0) {
         allocateNewChunk();
     }
     
     ~MemoryPool() {
-        for (size_t i = 0; i < usedBlocks; ++i) {
+        for (ChunkHeader* chunk : chunks) {
+            pages.unmap(chunk, chunkBytes, chunkAlignment);
         }
     }
     
+    MemoryPool(const MemoryPool&) = delete;
+    MemoryPool& operator=(const MemoryPool&) = delete;
+    
+    // Partially used chunks are filled before idle ones are touched, which
+    // keeps live blocks packed and leaves idle chunks free to be released.
     T* allocate() {
-        if (!freeList) {
-            allocateNewChunk();
+        ChunkHeader* chunk = partialChunks;
+        if (!chunk) {
+            if (!idleList) {
+                allocateNewChunk();
+            }
+            chunk = idleList;
+            unlinkChunk(idleList, chunk);
+            linkChunk(partialChunks, chunk);
+            --idleChunks;
         }
         
-        Block* block = freeList;
-        freeList = freeList->next;
+        Block* block = chunk->freeList;
+        chunk->freeList = block->next;
+        ++chunk->liveBlocks;
         usedBlocks++;
         
+        if (!chunk->freeList) {
+            unlinkChunk(partialChunks, chunk);
+        }
+        
         return reinterpret_cast<T*>(block);
     }
     
@@ -60,9 +424,291 @@ public:
         if (!ptr) return;
         
         Block* block = reinterpret_cast<Block*>(ptr);
-        block->next = freeList;
-        freeList = block;
+        ChunkHeader* chunk = chunkOf(block);
+        if (!chunk->freeList) {
+            linkChunk(partialChunks, chunk);
+        }
+        block->next = chunk->freeList;
+        chunk->freeList = block;
         usedBlocks--;
+        
+        if (--chunk->liveBlocks == 0) {
+            unlinkChunk(partialChunks, chunk);
+            linkChunk(idleList, chunk);
+            if (++idleChunks > idleHighWatermark) {
+                // Trim to half the watermark so a workload hovering at the limit
+                // does not map and unmap a chunk on every other deallocation.
+                trim(idleHighWatermark / 2);
+            }
+        }
+    }
+    
+    template<typename... Args>
+    T* construct(Args&&... args) {
+        T* ptr = allocate();
+        new (ptr) T(forward<Args>(args)...);
+        return ptr;
+    }
+    
+    void destroy(T* ptr) {
+        if (ptr) {
+            ptr->~T();
+            deallocate(ptr);
+        }
+    }
+    
+    // Returns completely free chunks to the OS until at most keepIdle remain.
+    // Constant work per released chunk; returns the number of chunks released.
+    size_t trim(size_t keepIdle = 0) {
+        size_t released = 0;
+        while (idleChunks > keepIdle) {
+            ChunkHeader* chunk = idleList;
+            unlinkChunk(idleList, chunk);
+            releaseChunk(chunk);
+            --idleChunks;
+            ++released;
+        }
+        
+        totalBlocks -= released * blocksPerChunk;
+        releasedChunks += released;
+        return released;
+    }
+    
+    // Automatic trimming starts once more than this many chunks sit completely
+    // free; SIZE_MAX turns it off and leaves trimming to explicit trim() calls.
+    void setIdleChunkLimit(size_t limit) {
+        idleHighWatermark = limit;
+        if (idleChunks > idleHighWatermark) {
+            trim(idleHighWatermark / 2);
+        }
+    }
+    
+    size_t getUsedBlocks() const { return usedBlocks; }
+    size_t getTotalBlocks() const { return totalBlocks; }
+    size_t getChunkCount() const { return chunks.size(); }
+    size_t getIdleChunkCount() const { return idleChunks; }
+    size_t getBlocksPerChunk() const { return blocksPerChunk; }
+    PageProvider::Stats getPageStats() const { return pages.getStats(); }
+    double getUtilization() const { 
+        return totalBlocks > 0 ? static_cast<double>(usedBlocks) / totalBlocks : 0.0; 
+    }
+    
+    Stats getStats() const {
+        size_t strandedBlocks = 0;
+        for (const ChunkHeader* chunk : chunks) {
+            if (chunk->liveBlocks > 0) {
+                strandedBlocks += blocksPerChunk - chunk->liveBlocks;
+            }
+        }
+        size_t freeBlocks = totalBlocks - usedBlocks;
+        
+        return Stats{
+            chunks.size(), idleChunks, usedBlocks, totalBlocks,
+            chunks.size() * chunkBytes, peakChunks * chunkBytes, releasedChunks,
+            getUtilization(),
+            freeBlocks > 0 ? static_cast<double>(strandedBlocks) / freeBlocks : 0.0
+        };
+    }
+};
+
+// Thread-safe pool: every thread keeps a small magazine of free blocks and only
+// touches shared state to swap whole batches with a lock-free depot, so the
+// common allocate/deallocate is a few non-atomic instructions on thread-local data.
+template<typename T, size_t PoolSize = 1024>
+class ConcurrentMemoryPool {
+private:
+    static constexpr size_t BATCH_SIZE = 32;
+    static constexpr size_t MAGAZINE_CAPACITY = 2 * BATCH_SIZE;
+    
+    union Block {
+        alignas(T) unsigned char data[sizeof(T)];
+        struct {
+            Block* next;        // next block in the same batch
+            Block* nextBatch;   // next batch in the depot, only used on a batch's first block
+        } link;
+    };
+    
+    // State shared with the thread caches. Held by shared_ptr so that a thread
+    // exiting after the pool is gone can tell, through its weak_ptr, not to touch it.
+    struct Shared {
+        atomic<uint64_t> depotHead{0};   // tagged pointer to the first batch
+        atomic<size_t> depotBlocks{0};
+        mutex chunkMutex;
+        vector<unique_ptr<Block[]>> chunks;
+        atomic<size_t> totalBlocks{0};
+        uint64_t id;
+    };
+    
+    // Upper 16 bits of the depot head carry a version tag against ABA on pop.
+    static constexpr uint64_t POINTER_MASK = (uint64_t(1) << 48) - 1;
+    
+    static Block* pointerOf(uint64_t tagged) {
+        return reinterpret_cast<Block*>(tagged & POINTER_MASK);
+    }
+    
+    static uint64_t makeTagged(Block* block, uint64_t previous) {
+        return reinterpret_cast<uintptr_t>(block) | ((previous & ~POINTER_MASK) + (uint64_t(1) << 48));
+    }
+    
+    struct Magazine {
+        uint64_t poolId;
+        weak_ptr<Shared> owner;
+        Block* blocks[MAGAZINE_CAPACITY];
+        size_t count;
+    };
+    
+    // One per thread and pool instantiation; returns cached blocks when the thread exits.
+    struct ThreadCache {
+        vector<unique_ptr<Magazine>> magazines;
+        Magazine* last = nullptr;
+        
+        ~ThreadCache() {
+            for (auto& magazine : magazines) {
+                if (auto shared = magazine->owner.lock()) {
+                    while (magazine->count > 0) {
+                        size_t n = min(magazine->count, BATCH_SIZE);
+                        magazine->count -= n;
+                        pushBatch(*shared, magazine->blocks + magazine->count, n);
+                    }
+                }
+            }
+        }
+    };
+    
+    shared_ptr<Shared> shared;
+    
+    static atomic<uint64_t>& nextPoolId() {
+        static atomic<uint64_t> id{1};
+        return id;
+    }
+    
+    static void pushBatch(Shared& state, Block** blocks, size_t n) {
+        for (size_t i = 0; i + 1 < n; ++i) {
+            blocks[i]->link.next = blocks[i + 1];
+        }
+        blocks[n - 1]->link.next = nullptr;
+        
+        Block* head = blocks[0];
+        uint64_t old = state.depotHead.load(memory_order_relaxed);
+        do {
+            atomic_ref<Block*>(head->link.nextBatch).store(pointerOf(old), memory_order_relaxed);
+        } while (!state.depotHead.compare_exchange_weak(old, makeTagged(head, old),
+                                                        memory_order_release, memory_order_relaxed));
+        state.depotBlocks.fetch_add(n, memory_order_relaxed);
+    }
+    
+    static Block* popBatch(Shared& state) {
+        uint64_t old = state.depotHead.load(memory_order_acquire);
+        while (Block* head = pointerOf(old)) {
+            // Blocks are never returned to the OS while the pool lives, so reading a
+            // head another thread just popped is safe; the tag makes the CAS fail.
+            Block* next = atomic_ref<Block*>(head->link.nextBatch).load(memory_order_relaxed);
+            if (state.depotHead.compare_exchange_weak(old, makeTagged(next, old),
+                                                      memory_order_acquire, memory_order_acquire)) {
+                return head;
+            }
+        }
+        return nullptr;
+    }
+    
+    Magazine& localMagazine() {
+        thread_local ThreadCache cache;
+        if (cache.last && cache.last->poolId == shared->id) {
+            return *cache.last;
+        }
+        
+        for (auto& magazine : cache.magazines) {
+            if (magazine->poolId == shared->id) {
+                cache.last = magazine.get();
+                return *magazine;
+            }
+        }
+        
+        // Drop entries of pools that no longer exist before adding this one.
+        erase_if(cache.magazines, [](const unique_ptr<Magazine>& magazine) { return magazine->owner.expired(); });
+        
+        auto magazine = make_unique<Magazine>();
+        magazine->poolId = shared->id;
+        magazine->owner = shared;
+        magazine->count = 0;
+        cache.last = magazine.get();
+        cache.magazines.push_back(move(magazine));
+        return *cache.last;
+    }
+    
+    void refill(Magazine& magazine) {
+        Block* batch = popBatch(*shared);
+        if (!batch) {
+            batch = allocateNewChunk();
+        }
+        
+        size_t n = 0;
+        for (Block* block = batch; block; block = block->link.next) {
+            magazine.blocks[magazine.count++] = block;
+            ++n;
+        }
+        shared->depotBlocks.fetch_sub(n, memory_order_relaxed);
+    }
+    
+    // Carves a fresh chunk into batches, keeps the first and publishes the rest.
+    Block* allocateNewChunk() {
+        lock_guard<mutex> lock(shared->chunkMutex);
+        
+        // Another thread may have grown the pool while we waited.
+        if (Block* batch = popBatch(*shared)) {
+            return batch;
+        }
+        
+        size_t blocksPerChunk = max(PoolSize, BATCH_SIZE);
+        auto chunk = make_unique<Block[]>(blocksPerChunk);
+        Block* first = chunk.get();
+        
+        vector<Block*> blocks(BATCH_SIZE);
+        for (size_t start = BATCH_SIZE; start < blocksPerChunk; start += BATCH_SIZE) {
+            size_t n = min(BATCH_SIZE, blocksPerChunk - start);
+            for (size_t i = 0; i < n; ++i) {
+                blocks[i] = &chunk[start + i];
+            }
+            pushBatch(*shared, blocks.data(), n);
+        }
+        
+        for (size_t i = 0; i < BATCH_SIZE; ++i) {
+            chunk[i].link.next = i + 1 < BATCH_SIZE ? &chunk[i + 1] : nullptr;
+        }
+        // Counted as in the depot until refill() moves them to the magazine.
+        shared->depotBlocks.fetch_add(BATCH_SIZE, memory_order_relaxed);
+        
+        shared->totalBlocks.fetch_add(blocksPerChunk, memory_order_relaxed);
+        shared->chunks.push_back(move(chunk));
+        return first;
+    }
+    
+public:
+    ConcurrentMemoryPool() : shared(make_shared<Shared>()) {
+        shared->id = nextPoolId().fetch_add(1);
+    }
+    
+    ConcurrentMemoryPool(const ConcurrentMemoryPool&) = delete;
+    ConcurrentMemoryPool& operator=(const ConcurrentMemoryPool&) = delete;
+    
+    T* allocate() {
+        Magazine& magazine = localMagazine();
+        if (magazine.count == 0) {
+            refill(magazine);
+        }
+        return reinterpret_cast<T*>(magazine.blocks[--magazine.count]);
+    }
+    
+    void deallocate(T* ptr) {
+        if (!ptr) return;
+        
+        Magazine& magazine = localMagazine();
+        if (magazine.count == MAGAZINE_CAPACITY) {
+            // Keep half so alternating allocate/free at the boundary does not thrash the depot.
+            magazine.count -= BATCH_SIZE;
+            pushBatch(*shared, magazine.blocks + magazine.count, BATCH_SIZE);
+        }
+        magazine.blocks[magazine.count++] = reinterpret_cast<Block*>(ptr);
     }
     
     template<typename... Args>
@@ -79,134 +725,1010 @@ public:
         }
     }
     
-    size_t getUsedBlocks() const { return usedBlocks; }
-    size_t getTotalBlocks() const { return totalBlocks; }
-    size_t getChunkCount() const { return chunks.size(); }
-    double getUtilization() const { 
-        return totalBlocks > 0 ? static_cast<double>(usedBlocks) / totalBlocks : 0.0; 
+    // Blocks not in the depot: in use or cached by some thread's magazine.
+    size_t getUsedBlocks() const {
+        return shared->totalBlocks.load(memory_order_relaxed) - shared->depotBlocks.load(memory_order_relaxed);
+    }
+    size_t getTotalBlocks() const { return shared->totalBlocks.load(memory_order_relaxed); }
+    size_t getChunkCount() const {
+        lock_guard<mutex> lock(shared->chunkMutex);
+        return shared->chunks.size();
+    }
+    double getUtilization() const {
+        size_t total = getTotalBlocks();
+        return total > 0 ? static_cast<double>(getUsedBlocks()) / total : 0.0;
+    }
+};
+
+// Generational handle pool. Objects live densely in one vector, so iteration
+// is a linear scan; handles go through a slot table that records each object's
+// dense position and a generation that changes on every erase, so a handle to
+// an erased object is detected instead of dangling. Insert, erase and lookup
+// are O(1); erase moves the last object into the hole. A narrower Generation
+// shrinks the slot table at the cost of retiring slots sooner.
+template<typename T, typename Generation = uint32_t>
+class SlotMap {
+public:
+    struct Handle {
+        uint32_t index = UINT32_MAX;
+        Generation generation = 0;
+        
+        bool operator==(const Handle&) const = default;
+    };
+    
+private:
+    // Odd generations mark occupied slots; a free slot's target is the next free slot.
+    struct Slot {
+        uint32_t target;
+        Generation generation;
+    };
+    
+    static constexpr uint32_t NO_SLOT = UINT32_MAX;
+    
+    vector<T> dense;
+    vector<uint32_t> denseToSlot;
+    vector<Slot> slots;
+    uint32_t freeHead;
+    
+    const Slot* liveSlot(Handle handle) const {
+        if (handle.index >= slots.size()) return nullptr;
+        const Slot& slot = slots[handle.index];
+        return slot.generation == handle.generation && (slot.generation & 1) ? &slot : nullptr;
+    }
+    
+public:
+    SlotMap() : freeHead(NO_SLOT) {}
+    
+    void reserve(size_t count) {
+        dense.reserve(count);
+        denseToSlot.reserve(count);
+        slots.reserve(count);
+    }
+    
+    template<typename... Args>
+    Handle emplace(Args&&... args) {
+        dense.emplace_back(forward<Args>(args)...);
+        
+        uint32_t index = freeHead;
+        if (index != NO_SLOT) {
+            freeHead = slots[index].target;
+        } else {
+            index = static_cast<uint32_t>(slots.size());
+            slots.push_back(Slot{NO_SLOT, 0});
+        }
+        denseToSlot.push_back(index);
+        
+        Slot& slot = slots[index];
+        slot.target = static_cast<uint32_t>(dense.size() - 1);
+        ++slot.generation;
+        return Handle{index, slot.generation};
+    }
+    
+    Handle insert(T value) {
+        return emplace(move(value));
+    }
+    
+    // Returns false for stale handles, so erasing twice is harmless.
+    bool erase(Handle handle) {
+        if (!liveSlot(handle)) return false;
+        
+        Slot& slot = slots[handle.index];
+        uint32_t hole = slot.target;
+        uint32_t last = static_cast<uint32_t>(dense.size() - 1);
+        if (hole != last) {
+            dense[hole] = move(dense[last]);
+            denseToSlot[hole] = denseToSlot[last];
+            slots[denseToSlot[hole]].target = hole;
+        }
+        dense.pop_back();
+        denseToSlot.pop_back();
+        
+        // The largest generation is odd, i.e. live. Incrementing it would wrap
+        // to 0 and hand out generation 1 again, so such a slot is retired: it
+        // stays dead at generation 0 and never returns to the free list.
+        if (slot.generation == numeric_limits<Generation>::max()) {
+            slot.generation = 0;
+        } else {
+            ++slot.generation;
+            slot.target = freeHead;
+            freeHead = handle.index;
+        }
+        return true;
+    }
+    
+    T* get(Handle handle) {
+        const Slot* slot = liveSlot(handle);
+        return slot ? &dense[slot->target] : nullptr;
+    }
+    
+    const T* get(Handle handle) const {
+        const Slot* slot = liveSlot(handle);
+        return slot ? &dense[slot->target] : nullptr;
+    }
+    
+    bool contains(Handle handle) const { return liveSlot(handle) != nullptr; }
+    
+    // Handle of the object at a dense position, e.g. while iterating.
+    Handle handleAt(size_t position) const {
+        uint32_t index = denseToSlot[position];
+        return Handle{index, slots[index].generation};
+    }
+    
+    void clear() {
+        while (!dense.empty()) {
+            erase(handleAt(dense.size() - 1));
+        }
+    }
+    
+    size_t size() const { return dense.size(); }
+    bool empty() const { return dense.empty(); }
+    
+    typename vector<T>::iterator begin() { return dense.begin(); }
+    typename vector<T>::iterator end() { return dense.end(); }
+    typename vector<T>::const_iterator begin() const { return dense.begin(); }
+    typename vector<T>::const_iterator end() const { return dense.end(); }
+};
+
+// Count policies for IntrusivePtr. SingleThreadCount is for object graphs that
+// never cross threads and avoids the locked instructions shared_ptr always pays.
+struct SingleThreadCount {
+    using Counter = uint32_t;
+    
+    static void increment(Counter& count) { ++count; }
+    static bool decrement(Counter& count) { return --count == 0; }
+    static uint32_t load(const Counter& count) { return count; }
+    
+    static bool incrementIfNonZero(Counter& count) {
+        if (count == 0) return false;
+        ++count;
+        return true;
+    }
+};
+
+struct ThreadSafeCount {
+    using Counter = atomic<uint32_t>;
+    
+    static void increment(Counter& count) { count.fetch_add(1, memory_order_relaxed); }
+    static uint32_t load(const Counter& count) { return count.load(memory_order_relaxed); }
+    
+    static bool decrement(Counter& count) {
+        if (count.fetch_sub(1, memory_order_release) == 1) {
+            atomic_thread_fence(memory_order_acquire);
+            return true;
+        }
+        return false;
+    }
+    
+    static bool incrementIfNonZero(Counter& count) {
+        uint32_t current = count.load(memory_order_relaxed);
+        while (current != 0) {
+            if (count.compare_exchange_weak(current, current + 1, memory_order_relaxed)) {
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+// Counts and object share one allocation: a heap block, or a single
+// MemoryPool slot when created through a pool. The object is destroyed when
+// the last strong reference goes; the block is freed once weak references are
+// gone too (all strong references together hold one weak reference).
+template<typename T, typename CountPolicy>
+struct RefCountBlock {
+    typename CountPolicy::Counter strong;
+    typename CountPolicy::Counter weak;
+    MemoryPool<RefCountBlock>* pool;
+    alignas(T) unsigned char storage[sizeof(T)];
+    
+    explicit RefCountBlock(MemoryPool<RefCountBlock>* owner) : strong(1), weak(1), pool(owner) {}
+    
+    T* object() { return launder(reinterpret_cast<T*>(storage)); }
+    
+    void releaseStrong() {
+        if (CountPolicy::decrement(strong)) {
+            object()->~T();
+            releaseWeak();
+        }
+    }
+    
+    void releaseWeak() {
+        if (CountPolicy::decrement(weak)) {
+            MemoryPool<RefCountBlock>* owner = pool;
+            this->~RefCountBlock();
+            if (owner) {
+                owner->deallocate(this);
+            } else {
+                ::operator delete(this);
+            }
+        }
+    }
+};
+
+// A pool whose slots hold both the counts and the object for IntrusivePtr<T>.
+// MemoryPool is not thread-safe, so pooled objects must be released on the
+// pool's thread even with ThreadSafeCount.
+template<typename T, typename CountPolicy = SingleThreadCount>
+using IntrusivePool = MemoryPool<RefCountBlock<T, CountPolicy>>;
+
+template<typename T, typename CountPolicy>
+class WeakIntrusivePtr;
+
+// Single-pointer strong reference: one word to copy, with no separate control block.
+template<typename T, typename CountPolicy = SingleThreadCount>
+class IntrusivePtr {
+private:
+    using Block = RefCountBlock<T, CountPolicy>;
+    
+    template<typename U, typename P>
+    friend class WeakIntrusivePtr;
+    
+    Block* block;
+    
+    explicit IntrusivePtr(Block* adopted) noexcept : block(adopted) {}
+    
+    template<typename... Args>
+    static IntrusivePtr construct(Block* block, Args&&... args) {
+        try {
+            new (block->storage) T(forward<Args>(args)...);
+        } catch (...) {
+            // No object yet, so release only the block.
+            block->strong = 0;
+            block->releaseWeak();
+            throw;
+        }
+        return IntrusivePtr(block);
+    }
+    
+public:
+    IntrusivePtr() noexcept : block(nullptr) {}
+    
+    IntrusivePtr(const IntrusivePtr& other) noexcept : block(other.block) {
+        if (block) CountPolicy::increment(block->strong);
+    }
+    
+    IntrusivePtr(IntrusivePtr&& other) noexcept : block(other.block) {
+        other.block = nullptr;
+    }
+    
+    IntrusivePtr& operator=(IntrusivePtr other) noexcept {
+        std::swap(block, other.block);
+        return *this;
+    }
+    
+    ~IntrusivePtr() {
+        if (block) block->releaseStrong();
+    }
+    
+    template<typename... Args>
+    static IntrusivePtr make(Args&&... args) {
+        void* memory = ::operator new(sizeof(Block));
+        return construct(new (memory) Block(nullptr), forward<Args>(args)...);
+    }
+    
+    template<typename... Args>
+    static IntrusivePtr makeIn(IntrusivePool<T, CountPolicy>& pool, Args&&... args) {
+        return construct(new (pool.allocate()) Block(&pool), forward<Args>(args)...);
+    }
+    
+    void reset() noexcept {
+        IntrusivePtr().swap(*this);
+    }
+    
+    void swap(IntrusivePtr& other) noexcept {
+        std::swap(block, other.block);
+    }
+    
+    T* get() const noexcept { return block ? block->object() : nullptr; }
+    T& operator*() const noexcept { return *get(); }
+    T* operator->() const noexcept { return get(); }
+    explicit operator bool() const noexcept { return block != nullptr; }
+    uint32_t useCount() const noexcept { return block ? CountPolicy::load(block->strong) : 0; }
+    
+    bool operator==(const IntrusivePtr& other) const noexcept { return block == other.block; }
+};
+
+template<typename T, typename CountPolicy = SingleThreadCount>
+class WeakIntrusivePtr {
+private:
+    using Block = RefCountBlock<T, CountPolicy>;
+    
+    Block* block;
+    
+public:
+    WeakIntrusivePtr() noexcept : block(nullptr) {}
+    
+    WeakIntrusivePtr(const IntrusivePtr<T, CountPolicy>& strong) noexcept : block(strong.block) {
+        if (block) CountPolicy::increment(block->weak);
+    }
+    
+    WeakIntrusivePtr(const WeakIntrusivePtr& other) noexcept : block(other.block) {
+        if (block) CountPolicy::increment(block->weak);
+    }
+    
+    WeakIntrusivePtr(WeakIntrusivePtr&& other) noexcept : block(other.block) {
+        other.block = nullptr;
+    }
+    
+    WeakIntrusivePtr& operator=(WeakIntrusivePtr other) noexcept {
+        std::swap(block, other.block);
+        return *this;
+    }
+    
+    ~WeakIntrusivePtr() {
+        if (block) block->releaseWeak();
+    }
+    
+    IntrusivePtr<T, CountPolicy> lock() const noexcept {
+        if (block && CountPolicy::incrementIfNonZero(block->strong)) {
+            return IntrusivePtr<T, CountPolicy>(block);
+        }
+        return IntrusivePtr<T, CountPolicy>();
+    }
+    
+    bool expired() const noexcept { return !block || CountPolicy::load(block->strong) == 0; }
+};
+
+template<size_t Size>
+class StackAllocator {
+private:
+    alignas(max_align_t) char buffer[Size];
+    size_t top;
+    
+public:
+    StackAllocator() : top(0) {}
+    
+    template<typename T>
+    T* allocate(size_t count = 1) {
+        size_t bytes = count * sizeof(T);
+        size_t aligned_bytes = (bytes + alignof(T) - 1) & ~(alignof(T) - 1);
+        
+        if (top + aligned_bytes > Size) {
+            throw bad_alloc();
+        }
+        
+        T* ptr = reinterpret_cast<T*>(buffer + top);
+        top += aligned_bytes;
+        return ptr;
+    }
+    
+    template<typename T>
+    void deallocate(T* ptr, size_t count = 1) {
+        size_t bytes = count * sizeof(T);
+        size_t aligned_bytes = (bytes + alignof(T) - 1) & ~(alignof(T) - 1);
+        
+        // Only the most recent allocation can be popped; use ScopedArena's
+        // mark()/rewind() when frees do not follow allocation order.
+        assert(reinterpret_cast<char*>(ptr) + aligned_bytes == buffer + top && "out-of-order free");
+        if (reinterpret_cast<char*>(ptr) + aligned_bytes == buffer + top) {
+            top -= aligned_bytes;
+        }
+    }
+    
+    // Byte-level interface used by StackMemoryResource: reports a full stack
+    // with nullptr instead of bad_alloc, and tryRelease() only pops the newest block.
+    void* tryAllocate(size_t bytes, size_t alignment) {
+        uintptr_t base = reinterpret_cast<uintptr_t>(buffer);
+        size_t start = ((base + top + alignment - 1) & ~(alignment - 1)) - base;
+        if (start + bytes > Size) {
+            return nullptr;
+        }
+        top = start + bytes;
+        return buffer + start;
+    }
+    
+    bool tryRelease(void* ptr, size_t bytes) {
+        if (static_cast<char*>(ptr) + bytes != buffer + top) {
+            return false;
+        }
+        top -= bytes;
+        return true;
+    }
+    
+    bool owns(const void* ptr) const {
+        return ptr >= buffer && ptr < buffer + Size;
+    }
+    
+    void reset() {
+        top = 0;
+    }
+    
+    size_t getBytesUsed() const { return top; }
+    size_t getBytesRemaining() const { return Size - top; }
+};
+
+class LinearAllocator {
+private:
+    char* buffer;
+    size_t size;
+    size_t offset;
+    bool ownsMemory;
+    optional<PageProvider> pages;   // set when the buffer is mapped rather than malloc'd
+    
+public:
+    LinearAllocator(size_t bufferSize) 
+        : size(bufferSize), offset(0), ownsMemory(true) {
+        buffer = static_cast<char*>(malloc(bufferSize));
+        if (!buffer) {
+            throw bad_alloc();
+        }
+    }
+    
+    LinearAllocator(size_t bufferSize, PageOptions options)
+        : size(bufferSize), offset(0), ownsMemory(true), pages(in_place, options) {
+        buffer = static_cast<char*>(pages->map(bufferSize, pages->granularity()));
+    }
+    
+    LinearAllocator(void* existingBuffer, size_t bufferSize)
+        : buffer(static_cast<char*>(existingBuffer)), size(bufferSize), 
+          offset(0), ownsMemory(false) {}
+    
+    ~LinearAllocator() {
+        if (ownsMemory && buffer) {
+            if (pages) {
+                pages->unmap(buffer, size, pages->granularity());
+            } else {
+                free(buffer);
+            }
+        }
+    }
+    
+    LinearAllocator(const LinearAllocator&) = delete;
+    LinearAllocator& operator=(const LinearAllocator&) = delete;
+    
+    template<typename T>
+    T* allocate(size_t count = 1) {
+        size_t bytes = count * sizeof(T);
+        size_t aligned_offset = (offset + alignof(T) - 1) & ~(alignof(T) - 1);
+        
+        if (aligned_offset + bytes > size) {
+            throw bad_alloc();
+        }
+        
+        T* ptr = reinterpret_cast<T*>(buffer + aligned_offset);
+        offset = aligned_offset + bytes;
+        return ptr;
+    }
+    
+    // Byte-level interface used by LinearMemoryResource: nullptr when full.
+    void* tryAllocate(size_t bytes, size_t alignment) {
+        uintptr_t base = reinterpret_cast<uintptr_t>(buffer);
+        size_t aligned_offset = ((base + offset + alignment - 1) & ~(alignment - 1)) - base;
+        if (aligned_offset + bytes > size) {
+            return nullptr;
+        }
+        offset = aligned_offset + bytes;
+        return buffer + aligned_offset;
+    }
+    
+    bool owns(const void* ptr) const {
+        return ptr >= buffer && ptr < buffer + size;
+    }
+    
+    void reset() {
+        offset = 0;
+    }
+    
+    size_t getBytesUsed() const { return offset; }
+    size_t getBytesRemaining() const { return size - offset; }
+    optional<PageProvider::Stats> getPageStats() const {
+        return pages ? optional(pages->getStats()) : nullopt;
+    }
+};
+
+// Scratch arena that is safe for non-trivial objects. make() records a
+// destructor for anything that needs one, rewind() runs those destructors in
+// reverse order back to a mark(), and a full block chains a new one instead
+// of throwing. Blocks released by rewind() are kept for reuse.
+class ScopedArena {
+private:
+    struct alignas(max_align_t) BlockHeader {
+        BlockHeader* prev;
+        size_t capacity;
+        size_t used;        // valid once a newer block has been chained on top
+    };
+    
+    // Finalizers live in the arena next to their objects, newest first.
+    struct Finalizer {
+        void (*destroy)(void* object, size_t count);
+        void* object;
+        size_t count;
+        Finalizer* prev;
+    };
+    
+    BlockHeader* current;
+    BlockHeader* spare;
+    size_t offset;
+    Finalizer* finalizers;
+    size_t blockSize;
+    size_t blockCount;
+    size_t bytesReserved;
+    
+    static char* dataOf(BlockHeader* block) {
+        return reinterpret_cast<char*>(block + 1);
+    }
+    
+    void chainBlock(size_t minBytes) {
+        BlockHeader** link = &spare;
+        while (*link && (*link)->capacity < minBytes) {
+            link = &(*link)->prev;
+        }
+        
+        BlockHeader* block = *link;
+        if (block) {
+            *link = block->prev;
+        } else {
+            size_t capacity = max(blockSize, minBytes);
+            block = static_cast<BlockHeader*>(malloc(sizeof(BlockHeader) + capacity));
+            if (!block) {
+                throw bad_alloc();
+            }
+            block->capacity = capacity;
+            bytesReserved += capacity;
+        }
+        
+        if (current) {
+            current->used = offset;
+        }
+        block->prev = current;
+        current = block;
+        offset = 0;
+        ++blockCount;
+    }
+    
+    template<typename T>
+    static void destroyObjects(void* object, size_t count) {
+        T* items = static_cast<T*>(object);
+        for (size_t i = count; i > 0; --i) {
+            items[i - 1].~T();
+        }
+    }
+    
+    // The finalizer slot is reserved before construction and linked only once
+    // construction succeeds, so a throwing constructor leaves nothing registered.
+    template<typename T>
+    Finalizer* reserveFinalizer() {
+        if constexpr (is_trivially_destructible_v<T>) {
+            return nullptr;
+        } else {
+            return static_cast<Finalizer*>(allocate(sizeof(Finalizer), alignof(Finalizer)));
+        }
+    }
+    
+    template<typename T>
+    void linkFinalizer(Finalizer* node, T* object, size_t count) {
+        if (node) {
+            *node = Finalizer{&destroyObjects<T>, object, count, finalizers};
+            finalizers = node;
+        }
+    }
+    
+public:
+    struct Marker {
+        BlockHeader* block;
+        size_t offset;
+        Finalizer* finalizers;
+    };
+    
+    explicit ScopedArena(size_t defaultBlockSize = 4096)
+        : current(nullptr), spare(nullptr), offset(0), finalizers(nullptr),
+          blockSize(defaultBlockSize), blockCount(0), bytesReserved(0) {}
+    
+    ~ScopedArena() {
+        reset();
+        while (spare) {
+            BlockHeader* prev = spare->prev;
+            free(spare);
+            spare = prev;
+        }
+    }
+    
+    ScopedArena(const ScopedArena&) = delete;
+    ScopedArena& operator=(const ScopedArena&) = delete;
+    
+    void* allocate(size_t bytes, size_t alignment = alignof(max_align_t)) {
+        if (current) {
+            uintptr_t base = reinterpret_cast<uintptr_t>(dataOf(current));
+            uintptr_t aligned = (base + offset + alignment - 1) & ~(alignment - 1);
+            if (aligned + bytes <= base + current->capacity) {
+                offset = aligned + bytes - base;
+                return reinterpret_cast<void*>(aligned);
+            }
+        }
+        
+        // Block data is max_align_t aligned, so only stricter alignments need slack.
+        chainBlock(bytes + (alignment > alignof(max_align_t) ? alignment : 0));
+        return allocate(bytes, alignment);
+    }
+    
+    template<typename T, typename... Args>
+    T* make(Args&&... args) {
+        Finalizer* node = reserveFinalizer<T>();
+        T* object = new (allocate(sizeof(T), alignof(T))) T(forward<Args>(args)...);
+        linkFinalizer(node, object, 1);
+        return object;
+    }
+    
+    // Default-constructs count elements; one finalizer covers the whole array.
+    template<typename T>
+    T* makeArray(size_t count) {
+        Finalizer* node = reserveFinalizer<T>();
+        T* items = static_cast<T*>(allocate(sizeof(T) * count, alignof(T)));
+        size_t constructed = 0;
+        try {
+            for (; constructed < count; ++constructed) {
+                new (&items[constructed]) T();
+            }
+        } catch (...) {
+            destroyObjects<T>(items, constructed);
+            throw;
+        }
+        linkFinalizer(node, items, count);
+        return items;
+    }
+    
+    Marker mark() const {
+        return Marker{current, offset, finalizers};
+    }
+    
+    // Destroys everything made since marker, newest first, and reclaims its memory.
+    // Markers must be rewound in LIFO order.
+    void rewind(Marker marker) {
+        while (finalizers != marker.finalizers) {
+            assert(finalizers && "marker does not belong to this arena's history");
+            Finalizer* node = finalizers;
+            finalizers = node->prev;
+            node->destroy(node->object, node->count);
+        }
+        
+        while (current != marker.block) {
+            assert(current && "marker does not belong to this arena's history");
+            BlockHeader* block = current;
+            current = block->prev;
+            block->prev = spare;
+            spare = block;
+            --blockCount;
+        }
+        offset = marker.offset;
+    }
+    
+    void reset() {
+        rewind(Marker{nullptr, 0, nullptr});
+    }
+    
+    size_t getBytesUsed() const {
+        size_t used = offset;
+        for (BlockHeader* block = current ? current->prev : nullptr; block; block = block->prev) {
+            used += block->used;
+        }
+        return used;
+    }
+    
+    size_t getBytesReserved() const { return bytesReserved; }
+    size_t getBlockCount() const { return blockCount; }
+};
+
+template<typename Allocator>
+class CustomAllocatorAdapter {
+private:
+    Allocator* allocator;
+    
+public:
+    using value_type = char;
+    
+    CustomAllocatorAdapter(Allocator* alloc) : allocator(alloc) {}
+    
+    template<typename T>
+    CustomAllocatorAdapter(const CustomAllocatorAdapter<T>& other) 
+        : allocator(other.allocator) {}
+    
+    char* allocate(size_t n) {
+        return allocator->template allocate<char>(n);
+    }
+    
+    void deallocate(char* ptr, size_t n) {
+        allocator->template deallocate<char>(ptr, n);
+    }
+    
+    template<typename T>
+    bool operator==(const CustomAllocatorAdapter<T>& other) const {
+        return allocator == other.allocator;
+    }
+    
+    template<typename T>
+    bool operator!=(const CustomAllocatorAdapter<T>& other) const {
+        return !(*this == other);
+    }
+};
+
+template<size_t Size>
+struct SlabBlock {
+    alignas(16) unsigned char bytes[Size];
+};
+
+// General-purpose allocator for variable-size requests: sizes up to 4 KB are
+// rounded up to one of 16 size classes, each served by its own MemoryPool, so
+// container node churn recycles pool blocks instead of calling malloc. Larger
+// or over-aligned requests fall through to operator new. Like MemoryPool it is
+// not thread-safe.
+class SlabAllocator {
+private:
+    static constexpr size_t CLASS_SIZES[] = {
+        16, 32, 48, 64, 96, 128, 192, 256, 384, 512, 768, 1024, 1536, 2048, 3072, 4096
+    };
+    static constexpr size_t CLASS_COUNT = size(CLASS_SIZES);
+    static constexpr size_t MAX_SIZE = 4096;
+    static constexpr size_t GRANULE = 16;
+    static constexpr size_t MAX_ALIGNMENT = 16;
+    
+    // Roughly 64 KB per chunk regardless of block size.
+    template<size_t Size>
+    using Pool = MemoryPool<SlabBlock<Size>, max<size_t>(16, 65536 / Size)>;
+    
+    template<size_t... I>
+    static auto makePools(index_sequence<I...>) -> tuple<Pool<CLASS_SIZES[I]>...>;
+    
+    using Pools = decltype(makePools(make_index_sequence<CLASS_COUNT>()));
+    
+    struct ClassOps {
+        void* (*allocate)(SlabAllocator&);
+        void (*deallocate)(SlabAllocator&, void*);
+        size_t (*usedBlocks)(const SlabAllocator&);
+        size_t (*totalBlocks)(const SlabAllocator&);
+    };
+    
+    template<size_t I>
+    static void* allocateFrom(SlabAllocator& self) {
+        return get<I>(self.pools).allocate();
+    }
+    
+    template<size_t I>
+    static void deallocateTo(SlabAllocator& self, void* ptr) {
+        get<I>(self.pools).deallocate(static_cast<SlabBlock<CLASS_SIZES[I]>*>(ptr));
+    }
+    
+    template<size_t I>
+    static size_t usedBlocksOf(const SlabAllocator& self) {
+        return get<I>(self.pools).getUsedBlocks();
+    }
+    
+    template<size_t I>
+    static size_t totalBlocksOf(const SlabAllocator& self) {
+        return get<I>(self.pools).getTotalBlocks();
+    }
+    
+    template<size_t... I>
+    static constexpr array<ClassOps, CLASS_COUNT> makeOps(index_sequence<I...>) {
+        return {{ {&allocateFrom<I>, &deallocateTo<I>, &usedBlocksOf<I>, &totalBlocksOf<I>}... }};
+    }
+    
+    // Built inside a function body, where the class is complete.
+    static const ClassOps& ops(size_t index) {
+        static constexpr array<ClassOps, CLASS_COUNT> table = makeOps(make_index_sequence<CLASS_COUNT>());
+        return table[index];
+    }
+    
+    // Size class for every 16-byte granule, so the lookup is a single table load.
+    static size_t classOf(size_t bytes) {
+        static constexpr array<uint8_t, MAX_SIZE / GRANULE + 1> table = []() {
+            array<uint8_t, MAX_SIZE / GRANULE + 1> result{};
+            size_t sizeClass = 0;
+            for (size_t granules = 0; granules < result.size(); ++granules) {
+                while (CLASS_SIZES[sizeClass] < granules * GRANULE) {
+                    ++sizeClass;
+                }
+                result[granules] = static_cast<uint8_t>(sizeClass);
+            }
+            return result;
+        }();
+        return table[(bytes + GRANULE - 1) / GRANULE];
+    }
+    
+    Pools pools;
+    size_t largeAllocations;
+    
+    static bool isPooled(size_t bytes, size_t alignment) {
+        return bytes <= MAX_SIZE && alignment <= MAX_ALIGNMENT;
+    }
+    
+public:
+    SlabAllocator() : largeAllocations(0) {}
+    
+    SlabAllocator(const SlabAllocator&) = delete;
+    SlabAllocator& operator=(const SlabAllocator&) = delete;
+    
+    void* allocate(size_t bytes, size_t alignment = alignof(max_align_t)) {
+        if (!isPooled(bytes, alignment)) {
+            ++largeAllocations;
+            return ::operator new(bytes, align_val_t(alignment));
+        }
+        return ops(classOf(bytes)).allocate(*this);
+    }
+    
+    // Callers pass back the size and alignment they allocated with, as with sized delete.
+    void deallocate(void* ptr, size_t bytes, size_t alignment = alignof(max_align_t)) {
+        if (!ptr) return;
+        
+        if (!isPooled(bytes, alignment)) {
+            --largeAllocations;
+            ::operator delete(ptr, align_val_t(alignment));
+            return;
+        }
+        ops(classOf(bytes)).deallocate(*this, ptr);
+    }
+    
+    static constexpr size_t classCount() { return CLASS_COUNT; }
+    static constexpr size_t classSize(size_t index) { return CLASS_SIZES[index]; }
+    size_t getUsedBlocks(size_t index) const { return ops(index).usedBlocks(*this); }
+    size_t getTotalBlocks(size_t index) const { return ops(index).totalBlocks(*this); }
+    size_t getLargeAllocations() const { return largeAllocations; }
+    
+    void printStats() const {
+        cout << "Slab classes in use:" << endl;
+        for (size_t i = 0; i < CLASS_COUNT; ++i) {
+            if (getUsedBlocks(i) > 0) {
+                cout << "  " << CLASS_SIZES[i] << " B: " << getUsedBlocks(i) << " used / " 
+                     << getTotalBlocks(i) << " blocks" << endl;
+            }
+        }
+        cout << "  large (> " << MAX_SIZE << " B): " << largeAllocations << " live" << endl;
     }
 };
 
-template<size_t Size>
-class StackAllocator {
+// std::allocator-conforming front end for SlabAllocator, so node-based standard
+// containers (map, set, list, unordered_map nodes) allocate from the slabs.
+template<typename T>
+class SlabAllocatorAdapter {
 private:
-    char buffer[Size];
-    size_t top;
+    template<typename U>
+    friend class SlabAllocatorAdapter;
+    
+    SlabAllocator* slab;
     
 public:
-    StackAllocator() : top(0) {}
+    using value_type = T;
     
-    template<typename T>
-    T* allocate(size_t count = 1) {
-        size_t bytes = count * sizeof(T);
-        size_t aligned_bytes = (bytes + alignof(T) - 1) & ~(alignof(T) - 1);
-        
-        if (top + aligned_bytes > Size) {
-            throw bad_alloc();
+    explicit SlabAllocatorAdapter(SlabAllocator* allocator) noexcept : slab(allocator) {}
+    
+    template<typename U>
+    SlabAllocatorAdapter(const SlabAllocatorAdapter<U>& other) noexcept : slab(other.slab) {}
+    
+    T* allocate(size_t n) {
+        if (n > SIZE_MAX / sizeof(T)) {
+            throw bad_array_new_length();
         }
-        
-        T* ptr = reinterpret_cast<T*>(buffer + top);
-        top += aligned_bytes;
-        return ptr;
+        return static_cast<T*>(slab->allocate(n * sizeof(T), alignof(T)));
     }
     
-    template<typename T>
-    void deallocate(T* ptr, size_t count = 1) {
-        size_t bytes = count * sizeof(T);
-        size_t aligned_bytes = (bytes + alignof(T) - 1) & ~(alignof(T) - 1);
-        
-        if (reinterpret_cast<char*>(ptr) + aligned_bytes == buffer + top) {
-            top -= aligned_bytes;
-        }
+    void deallocate(T* ptr, size_t n) noexcept {
+        slab->deallocate(ptr, n * sizeof(T), alignof(T));
     }
     
-    void reset() {
-        top = 0;
+    template<typename U>
+    bool operator==(const SlabAllocatorAdapter<U>& other) const noexcept {
+        return slab == other.slab;
     }
     
-    size_t getBytesUsed() const { return top; }
-    size_t getBytesRemaining() const { return Size - top; }
+    template<typename U>
+    bool operator!=(const SlabAllocatorAdapter<U>& other) const noexcept {
+        return slab != other.slab;
+    }
 };
 
-class LinearAllocator {
+// std::pmr front ends, so pmr::vector, pmr::string and pmr::unordered_map can be
+// built on these allocators. Whatever an allocator cannot serve (a full arena,
+// a block too large for the pool) goes to the upstream resource instead.
+template<size_t BlockSize, size_t PoolSize = 1024>
+class PoolMemoryResource : public pmr::memory_resource {
 private:
-    char* buffer;
-    size_t size;
-    size_t offset;
-    bool ownsMemory;
+    MemoryPool<SlabBlock<BlockSize>, PoolSize> pool;
+    pmr::memory_resource* upstream;
+    size_t upstreamAllocations;
     
-public:
-    LinearAllocator(size_t bufferSize) 
-        : size(bufferSize), offset(0), ownsMemory(true) {
-        buffer = static_cast<char*>(malloc(bufferSize));
-        if (!buffer) {
-            throw bad_alloc();
-        }
+    static bool fits(size_t bytes, size_t alignment) {
+        return bytes <= BlockSize && alignment <= alignof(SlabBlock<BlockSize>);
     }
     
-    LinearAllocator(void* existingBuffer, size_t bufferSize)
-        : buffer(static_cast<char*>(existingBuffer)), size(bufferSize), 
-          offset(0), ownsMemory(false) {}
-    
-    ~LinearAllocator() {
-        if (ownsMemory && buffer) {
-            free(buffer);
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        if (fits(bytes, alignment)) {
+            return pool.allocate();
         }
+        ++upstreamAllocations;
+        return upstream->allocate(bytes, alignment);
     }
     
-    template<typename T>
-    T* allocate(size_t count = 1) {
-        size_t bytes = count * sizeof(T);
-        size_t aligned_offset = (offset + alignof(T) - 1) & ~(alignof(T) - 1);
-        
-        if (aligned_offset + bytes > size) {
-            throw bad_alloc();
+    void do_deallocate(void* ptr, size_t bytes, size_t alignment) override {
+        if (fits(bytes, alignment)) {
+            pool.deallocate(static_cast<SlabBlock<BlockSize>*>(ptr));
+        } else {
+            upstream->deallocate(ptr, bytes, alignment);
         }
-        
-        T* ptr = reinterpret_cast<T*>(buffer + aligned_offset);
-        offset = aligned_offset + bytes;
-        return ptr;
     }
     
-    void reset() {
-        offset = 0;
+    bool do_is_equal(const pmr::memory_resource& other) const noexcept override {
+        return this == &other;
     }
     
-    size_t getBytesUsed() const { return offset; }
-    size_t getBytesRemaining() const { return size - offset; }
+public:
+    explicit PoolMemoryResource(pmr::memory_resource* up = pmr::get_default_resource(),
+                                PageOptions options = {})
+        : pool(options), upstream(up), upstreamAllocations(0) {}
+    
+    const MemoryPool<SlabBlock<BlockSize>, PoolSize>& getPool() const { return pool; }
+    size_t getUpstreamAllocations() const { return upstreamAllocations; }
 };
 
-template<typename Allocator>
-class CustomAllocatorAdapter {
+// Deallocation is a no-op for arena memory; it comes back all at once when the
+// LinearAllocator is reset, which must happen after every container using it is gone.
+class LinearMemoryResource : public pmr::memory_resource {
 private:
-    Allocator* allocator;
-    
-public:
-    using value_type = char;
+    LinearAllocator& arena;
+    pmr::memory_resource* upstream;
+    size_t upstreamAllocations;
     
-    CustomAllocatorAdapter(Allocator* alloc) : allocator(alloc) {}
+    // A zero-byte request still takes a byte, so the pointer never equals the
+    // arena's end, where owns() would misroute its free to upstream.
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        if (void* ptr = arena.tryAllocate(max<size_t>(bytes, 1), alignment)) {
+            return ptr;
+        }
+        ++upstreamAllocations;
+        return upstream->allocate(bytes, alignment);
+    }
     
-    template<typename T>
-    CustomAllocatorAdapter(const CustomAllocatorAdapter<T>& other) 
-        : allocator(other.allocator) {}
+    void do_deallocate(void* ptr, size_t bytes, size_t alignment) override {
+        if (!arena.owns(ptr)) {
+            upstream->deallocate(ptr, bytes, alignment);
+        }
+    }
     
-    char* allocate(size_t n) {
-        return allocator->template allocate<char>(n);
+    bool do_is_equal(const pmr::memory_resource& other) const noexcept override {
+        return this == &other;
     }
     
-    void deallocate(char* ptr, size_t n) {
-        allocator->template deallocate<char>(ptr, n);
+public:
+    explicit LinearMemoryResource(LinearAllocator& allocator,
+                                  pmr::memory_resource* up = pmr::get_default_resource())
+        : arena(allocator), upstream(up), upstreamAllocations(0) {}
+    
+    size_t getUpstreamAllocations() const { return upstreamAllocations; }
+};
+
+// Frees of the most recent block pop the stack; any other free is deferred to reset().
+template<size_t Size>
+class StackMemoryResource : public pmr::memory_resource {
+private:
+    StackAllocator<Size>& stack;
+    pmr::memory_resource* upstream;
+    size_t upstreamAllocations;
+    
+    // Zero-byte requests are rounded up for the same reason as in LinearMemoryResource.
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        if (void* ptr = stack.tryAllocate(max<size_t>(bytes, 1), alignment)) {
+            return ptr;
+        }
+        ++upstreamAllocations;
+        return upstream->allocate(bytes, alignment);
     }
     
-    template<typename T>
-    bool operator==(const CustomAllocatorAdapter<T>& other) const {
-        return allocator == other.allocator;
+    void do_deallocate(void* ptr, size_t bytes, size_t alignment) override {
+        if (stack.owns(ptr)) {
+            stack.tryRelease(ptr, max<size_t>(bytes, 1));
+        } else {
+            upstream->deallocate(ptr, bytes, alignment);
+        }
     }
     
-    template<typename T>
-    bool operator!=(const CustomAllocatorAdapter<T>& other) const {
-        return !(*this == other);
+    bool do_is_equal(const pmr::memory_resource& other) const noexcept override {
+        return this == &other;
     }
+    
+public:
+    explicit StackMemoryResource(StackAllocator<Size>& allocator,
+                                 pmr::memory_resource* up = pmr::get_default_resource())
+        : stack(allocator), upstream(up), upstreamAllocations(0) {}
+    
+    size_t getUpstreamAllocations() const { return upstreamAllocations; }
 };
 
 class TestObject {
@@ -274,6 +1796,385 @@ void performanceComparison() {
     cout << "Speedup: " << static_cast<double>(standardTime.count()) / poolTime.count() << "x" << endl;
 }
 
+void concurrentPoolComparison() {
+    cout << "\n=== Concurrent Pool Comparison ===" << endl;
+    
+    // Each thread repeatedly allocates a burst of objects and frees them again.
+    const size_t burst = 64;
+    const size_t rounds = 4000;
+    
+    auto run = [&](size_t threadCount, auto allocateOne, auto freeOne) {
+        vector<thread> threads;
+        auto start = chrono::high_resolution_clock::now();
+        for (size_t t = 0; t < threadCount; ++t) {
+            threads.emplace_back([&, t]() {
+                vector<TestObject*> objects(burst);
+                for (size_t round = 0; round < rounds; ++round) {
+                    for (size_t i = 0; i < burst; ++i) {
+                        objects[i] = allocateOne(static_cast<int>(t + i));
+                    }
+                    for (size_t i = 0; i < burst; ++i) {
+                        freeOne(objects[i]);
+                    }
+                }
+            });
+        }
+        for (auto& t : threads) {
+            t.join();
+        }
+        auto end = chrono::high_resolution_clock::now();
+        double ns = chrono::duration<double, nano>(end - start).count();
+        return ns / (threadCount * rounds * burst);
+    };
+    
+    cout << "ns per allocate+free pair (" << thread::hardware_concurrency() << " hardware threads)" << endl;
+    cout << "threads  new/delete  MemoryPool+mutex  ConcurrentMemoryPool" << endl;
+    for (size_t threadCount = 1; threadCount <= 32; threadCount *= 2) {
+        double heap = run(threadCount,
+            [](int value) { return new TestObject(value, "heap"); },
+            [](TestObject* obj) { delete obj; });
+        
+        MemoryPool<TestObject> lockedPool;
+        mutex poolMutex;
+        double locked = run(threadCount,
+            [&](int value) { lock_guard<mutex> lock(poolMutex); return lockedPool.construct(value, "locked"); },
+            [&](TestObject* obj) { lock_guard<mutex> lock(poolMutex); lockedPool.destroy(obj); });
+        
+        ConcurrentMemoryPool<TestObject> concurrentPool;
+        double concurrent = run(threadCount,
+            [&](int value) { return concurrentPool.construct(value, "pooled"); },
+            [&](TestObject* obj) { concurrentPool.destroy(obj); });
+        
+        cout << threadCount << "\t " << heap << "\t     " << locked << "\t       " << concurrent
+             << " (" << concurrentPool.getChunkCount() << " chunks)" << endl;
+    }
+}
+
+void demonstrateSlabAllocator() {
+    cout << "\n=== Slab Allocator Demo ===" << endl;
+    
+    SlabAllocator slab;
+    void* small = slab.allocate(24);
+    void* medium = slab.allocate(700);
+    void* large = slab.allocate(10000);
+    slab.printStats();
+    slab.deallocate(small, 24);
+    slab.deallocate(medium, 700);
+    slab.deallocate(large, 10000);
+    
+    // Node churn: keep a window of live keys while inserting and erasing.
+    const int operations = 1000000;
+    const int window = 10000;
+    
+    auto churnMap = [&](auto& m) {
+        for (int i = 0; i < operations; ++i) {
+            m.emplace(i, "value");
+            if (i >= window) {
+                m.erase(i - window);
+            }
+        }
+        return m.size();
+    };
+    
+    auto churnList = [&](auto& l) {
+        for (int i = 0; i < operations; ++i) {
+            l.push_back(i);
+            if (i >= window) {
+                l.pop_front();
+            }
+        }
+        return l.size();
+    };
+    
+    auto time = [](auto&& body) {
+        auto start = chrono::high_resolution_clock::now();
+        body();
+        auto end = chrono::high_resolution_clock::now();
+        return chrono::duration_cast<chrono::milliseconds>(end - start).count();
+    };
+    
+    using SlabMap = map<int, string, less<int>, SlabAllocatorAdapter<pair<const int, string>>>;
+    using SlabList = list<int, SlabAllocatorAdapter<int>>;
+    
+    map<int, string> heapMap;
+    SlabMap slabMap{SlabAllocatorAdapter<pair<const int, string>>(&slab)};
+    list<int> heapList;
+    SlabList slabList{SlabAllocatorAdapter<int>(&slab)};
+    
+    cout << "\nNode churn (" << operations << " insert/erase pairs, " << window << " live):" << endl;
+    cout << "map<int, string>  std::allocator: " << time([&]() { churnMap(heapMap); }) << " ms, slab: "
+         << time([&]() { churnMap(slabMap); }) << " ms" << endl;
+    cout << "list<int>         std::allocator: " << time([&]() { churnList(heapList); }) << " ms, slab: "
+         << time([&]() { churnList(slabList); }) << " ms" << endl;
+    slab.printStats();
+}
+
+void demonstrateChunkReclamation() {
+    cout << "\n=== Chunk Reclamation Demo ===" << endl;
+    
+    auto printStats = [](const char* label, const MemoryPool<TestObject>& pool) {
+        auto stats = pool.getStats();
+        cout << label << ": " << stats.chunks << " chunks (" << stats.idleChunks << " idle), "
+             << stats.bytesMapped / 1024 << " KB mapped (peak " << stats.peakBytesMapped / 1024 << " KB), "
+             << "utilization " << stats.utilization * 100 << "%, fragmentation " 
+             << stats.fragmentation * 100 << "%, RSS " << residentBytes() / 1024 << " KB" << endl;
+    };
+    
+    MemoryPool<TestObject> pool;
+    vector<TestObject*> objects;
+    
+    // A burst far above the steady-state working set.
+    for (int i = 0; i < 200000; ++i) {
+        objects.push_back(pool.construct(i, "burst"));
+    }
+    printStats("After burst     ", pool);
+    
+    // Keep every 100th object: most chunks stay pinned by a single survivor.
+    vector<TestObject*> survivors;
+    for (size_t i = 0; i < objects.size(); ++i) {
+        if (i % 100 == 0 && i < 20000) {
+            survivors.push_back(objects[i]);
+        } else {
+            pool.destroy(objects[i]);
+        }
+    }
+    printStats("After release   ", pool);
+    
+    pool.trim();
+    printStats("After trim()    ", pool);
+    
+    for (TestObject* obj : survivors) {
+        pool.destroy(obj);
+    }
+    printStats("All freed       ", pool);
+    cout << "Chunks returned to the OS: " << pool.getStats().releasedChunks << endl;
+}
+
+void demonstrateHugePages() {
+    cout << "\n=== Huge Page Backing Demo ===" << endl;
+    
+    // Pointer chasing over a 1 GB arena: every hop lands on a random page, so
+    // with 4 KB pages nearly every load also misses the TLB.
+    const size_t arenaBytes = size_t(1) << 30;
+    const size_t slots = arenaBytes / sizeof(uint64_t);
+    const size_t hops = 4000000;
+    
+    auto run = [&](const char* label, PageOptions options) {
+        LinearAllocator arena(arenaBytes, options);
+        uint64_t* next = arena.allocate<uint64_t>(slots);
+        
+        // A full-period LCG modulo the power-of-two slot count visits every slot once.
+        auto fillStart = chrono::high_resolution_clock::now();
+        for (size_t i = 0; i < slots; ++i) {
+            next[i] = (i * 6364136223846793005ULL + 1442695040888963407ULL) & (slots - 1);
+        }
+        auto fillEnd = chrono::high_resolution_clock::now();
+        
+        TlbMissCounter tlbMisses;
+        uint64_t slot = 0;
+        tlbMisses.start();
+        auto chaseStart = chrono::high_resolution_clock::now();
+        for (size_t i = 0; i < hops; ++i) {
+            slot = next[slot];
+        }
+        auto chaseEnd = chrono::high_resolution_clock::now();
+        uint64_t misses = tlbMisses.stop();
+        
+        auto pageStats = *arena.getPageStats();
+        cout << label << ": fill " << chrono::duration_cast<chrono::milliseconds>(fillEnd - fillStart).count()
+             << " ms, " << chrono::duration<double, nano>(chaseEnd - chaseStart).count() / hops << " ns/hop, dTLB misses ";
+        if (tlbMisses.available()) {
+            cout << misses;
+        } else {
+            cout << "n/a";
+        }
+        cout << " (hugetlb " << pageStats.hugetlbMappings << ", THP " << pageStats.transparentMappings
+             << ", NUMA-bound " << pageStats.boundMappings << ", end slot " << slot << ")" << endl;
+    };
+    
+    run("4 KB pages ", PageOptions{});
+    run("Huge pages ", PageOptions{true, true});
+    
+    MemoryPool<TestObject, 16384> pool(PageOptions{true, true});
+    cout << "Huge-page MemoryPool: " << pool.getBlocksPerChunk() << " blocks per chunk, "
+         << pool.getPageStats().mappings << " mapping(s)" << endl;
+}
+
+void demonstrateSlotMap() {
+    cout << "\n=== Slot Map Demo ===" << endl;
+    
+    SlotMap<TestObject> objects;
+    objects.emplace(1, "first");
+    auto second = objects.emplace(2, "second");
+    objects.emplace(3, "third");
+    
+    objects.erase(second);
+    auto reused = objects.emplace(4, "reused");
+    
+    cout << "Second handle after erase: " << (objects.get(second) ? "valid" : "stale") << endl;
+    cout << "Reused slot " << reused.index << " (generation " << reused.generation 
+         << ") vs stale handle slot " << second.index << " (generation " << second.generation << ")" << endl;
+    cout << "Erasing the stale handle again: " << (objects.erase(second) ? "erased" : "rejected") << endl;
+    cout << "Dense iteration:";
+    for (const TestObject& obj : objects) {
+        cout << " " << obj.getName();
+    }
+    cout << endl;
+    
+    // With 8-bit generations a slot runs out after 128 objects; it must then
+    // be retired instead of wrapping back to generation 1.
+    SlotMap<int, uint8_t> shortLived;
+    auto firstHandle = shortLived.emplace(0);
+    auto lastHandle = firstHandle;
+    shortLived.erase(firstHandle);
+    for (int i = 1; i < 128; ++i) {
+        lastHandle = shortLived.emplace(i);
+        shortLived.erase(lastHandle);
+    }
+    auto afterWrap = shortLived.emplace(128);
+    assert(lastHandle.index == firstHandle.index && lastHandle.generation == numeric_limits<uint8_t>::max());
+    assert(afterWrap.index != firstHandle.index && !shortLived.contains(firstHandle));
+    cout << "8-bit generations: slot " << firstHandle.index << " retired at generation " 
+         << static_cast<int>(lastHandle.generation) << ", next object went to slot " << afterWrap.index 
+         << ", first handle " << (shortLived.contains(firstHandle) ? "matches (bug)" : "still stale") << endl;
+    
+    // Object cache benchmark: a slot map against the shared_ptr/weak_ptr graph
+    // it replaces, with cache entries evicted and re-added along the way.
+    const size_t count = 100000;
+    const size_t lookups = 1000000;
+    mt19937 rng(7);
+    
+    SlotMap<TestObject> cache;
+    cache.reserve(count);
+    vector<SlotMap<TestObject>::Handle> handles;
+    vector<shared_ptr<TestObject>> owners;
+    vector<weak_ptr<TestObject>> refs;
+    for (size_t i = 0; i < count; ++i) {
+        handles.push_back(cache.emplace(static_cast<int>(i), "cached"));
+        owners.push_back(make_shared<TestObject>(static_cast<int>(i), "cached"));
+        refs.push_back(owners.back());
+    }
+    for (size_t i = 0; i < count; i += 10) {
+        cache.erase(handles[i]);
+        owners[i].reset();
+    }
+    
+    vector<size_t> picks(lookups);
+    for (auto& pick : picks) {
+        pick = rng() % count;
+    }
+    
+    auto time = [](auto&& body) {
+        auto start = chrono::high_resolution_clock::now();
+        long long result = body();
+        auto end = chrono::high_resolution_clock::now();
+        return make_pair(chrono::duration<double, milli>(end - start).count(), result);
+    };
+    
+    auto [slotLookupMs, slotHits] = time([&] {
+        long long hits = 0;
+        for (size_t pick : picks) {
+            if (TestObject* obj = cache.get(handles[pick])) hits += obj->getValue() >= 0;
+        }
+        return hits;
+    });
+    auto [weakLookupMs, weakHits] = time([&] {
+        long long hits = 0;
+        for (size_t pick : picks) {
+            if (auto obj = refs[pick].lock()) hits += obj->getValue() >= 0;
+        }
+        return hits;
+    });
+    auto [slotScanMs, slotSum] = time([&] {
+        long long sum = 0;
+        for (const TestObject& obj : cache) sum += obj.getValue();
+        return sum;
+    });
+    auto [sharedScanMs, sharedSum] = time([&] {
+        long long sum = 0;
+        for (const auto& obj : owners) if (obj) sum += obj->getValue();
+        return sum;
+    });
+    
+    cout << "Cache of " << count << " objects, " << lookups << " random lookups:" << endl;
+    cout << "  Lookup  - slot map: " << slotLookupMs << " ms, weak_ptr::lock: " << weakLookupMs 
+         << " ms (" << weakLookupMs / slotLookupMs << "x), hits " << slotHits << "/" << weakHits << endl;
+    cout << "  Iterate - slot map: " << slotScanMs << " ms, shared_ptr vector: " << sharedScanMs 
+         << " ms (" << sharedScanMs / slotScanMs << "x), sums " << (slotSum == sharedSum ? "match" : "DIFFER") << endl;
+}
+
+void demonstrateIntrusivePtr() {
+    cout << "\n=== Intrusive Pointer Demo ===" << endl;
+    
+    IntrusivePool<TestObject> pool;
+    WeakIntrusivePtr<TestObject> observer;
+    {
+        auto owner = IntrusivePtr<TestObject>::makeIn(pool, 42, "pooled");
+        auto copy = owner;
+        observer = owner;
+        cout << "Strong refs: " << owner.useCount() << ", pool slots used: " << pool.getUsedBlocks()
+             << ", sizeof(IntrusivePtr): " << sizeof(owner) << " vs sizeof(shared_ptr): " 
+             << sizeof(shared_ptr<TestObject>) << endl;
+        if (auto locked = observer.lock()) {
+            cout << "Weak lock while alive: " << locked->getName() << endl;
+        }
+    }
+    cout << "After owners left - expired: " << (observer.expired() ? "yes" : "no") 
+         << ", pool slots used: " << pool.getUsedBlocks() << " (kept by the weak ref)" << endl;
+    observer = WeakIntrusivePtr<TestObject>();
+    cout << "After weak ref reset - pool slots used: " << pool.getUsedBlocks() << endl;
+    
+    // Copy/destroy throughput: every pass copies each pointer into a temporary
+    // vector and drops it again, as when handing objects to short-lived work.
+    const size_t objects = 1000;
+    const size_t passes = 2000;
+    
+    auto measure = [&](auto makeOne) {
+        using Ptr = decltype(makeOne(0));
+        vector<Ptr> owners;
+        for (size_t i = 0; i < objects; ++i) {
+            owners.push_back(makeOne(static_cast<int>(i)));
+        }
+        vector<Ptr> borrowed;
+        borrowed.reserve(objects);
+        
+        auto start = chrono::high_resolution_clock::now();
+        for (size_t pass = 0; pass < passes; ++pass) {
+            for (const Ptr& ptr : owners) {
+                borrowed.push_back(ptr);
+            }
+            borrowed.clear();
+        }
+        auto end = chrono::high_resolution_clock::now();
+        return chrono::duration<double, nano>(end - start).count() / (objects * passes);
+    };
+    
+    IntrusivePool<TestObject, ThreadSafeCount> atomicPool;
+    double sharedNs = measure([](int i) { return make_shared<TestObject>(i, "shared"); });
+    double atomicNs = measure([&](int i) { return IntrusivePtr<TestObject, ThreadSafeCount>::makeIn(atomicPool, i, "atomic"); });
+    double plainNs = measure([&](int i) { return IntrusivePtr<TestObject>::makeIn(pool, i, "plain"); });
+    
+    cout << "Copy + destroy per pointer:" << endl;
+    cout << "  shared_ptr                      : " << sharedNs << " ns" << endl;
+    cout << "  IntrusivePtr<ThreadSafeCount>   : " << atomicNs << " ns (" << sharedNs / atomicNs << "x)" << endl;
+    cout << "  IntrusivePtr<SingleThreadCount> : " << plainNs << " ns (" << sharedNs / plainNs << "x)" << endl;
+    
+    // Creation and release: make_shared allocates from the heap, makeIn from a pool slot.
+    const size_t creations = 200000;
+    auto timeCreation = [&](auto makeOne) {
+        auto start = chrono::high_resolution_clock::now();
+        for (size_t i = 0; i < creations; ++i) {
+            auto ptr = makeOne(static_cast<int>(i));
+        }
+        auto end = chrono::high_resolution_clock::now();
+        return chrono::duration<double, nano>(end - start).count() / creations;
+    };
+    double makeSharedNs = timeCreation([](int i) { return make_shared<TestObject>(i, "shared"); });
+    double makePooledNs = timeCreation([&](int i) { return IntrusivePtr<TestObject>::makeIn(pool, i, "plain"); });
+    cout << "Create + release: make_shared " << makeSharedNs << " ns, pooled IntrusivePtr " << makePooledNs
+         << " ns (" << makeSharedNs / makePooledNs << "x)" << endl;
+}
+
 void demonstrateStackAllocator() {
     cout << "\n=== Stack Allocator Demo ===" << endl;
     
@@ -354,6 +2255,183 @@ void demonstrateLinearAllocator() {
     cout << endl;
 }
 
+void demonstrateScopedArena() {
+    cout << "\n=== Scoped Arena Demo ===" << endl;
+    
+    int liveSessions = 0;
+    
+    struct Session {
+        int& live;
+        string user;
+        vector<string> tags;
+        
+        Session(int& counter, string u, vector<string> t) 
+            : live(counter), user(move(u)), tags(move(t)) { ++live; }
+        ~Session() { --live; }
+    };
+    
+    // Small blocks so a single request already spills into chained blocks.
+    ScopedArena arena(512);
+    
+    for (int request = 0; request < 3; ++request) {
+        auto requestStart = arena.mark();
+        
+        Session* session = arena.make<Session>(liveSessions, "user" + to_string(request),
+                                               vector<string>{"a long tag that needs the heap", "admin"});
+        string* lines = arena.makeArray<string>(8);
+        for (int i = 0; i < 8; ++i) {
+            lines[i] = "line " + to_string(i) + " of request " + to_string(request);
+        }
+        
+        {
+            // Nested scratch space, discarded before the request finishes.
+            auto scratch = arena.mark();
+            for (int i = 0; i < 20; ++i) {
+                arena.make<Session>(liveSessions, "temp", vector<string>{});
+            }
+            cout << "Request " << request << " with scratch - live sessions: " << liveSessions
+                 << ", blocks: " << arena.getBlockCount() << ", used: " << arena.getBytesUsed() << " bytes" << endl;
+            arena.rewind(scratch);
+        }
+        
+        cout << "Request " << request << " after scratch rewind - live sessions: " << liveSessions
+             << ", user: " << session->user << ", last line: \"" << lines[7] << "\"" << endl;
+        
+        arena.rewind(requestStart);
+        cout << "Request " << request << " done - live sessions: " << liveSessions
+             << ", blocks: " << arena.getBlockCount() << ", reserved: " << arena.getBytesReserved() << " bytes" << endl;
+    }
+}
+
+// One request of the parse-and-aggregate benchmark: split access-log lines into
+// fields and accumulate per-path request counts and latency, all on resource.
+size_t aggregateRequest(const vector<string>& lines, size_t first, size_t count,
+                        pmr::memory_resource* resource) {
+    struct PathStats {
+        size_t requests = 0;
+        size_t errors = 0;
+        size_t totalLatency = 0;
+    };
+    
+    pmr::unordered_map<pmr::string, PathStats> byPath(resource);
+    pmr::vector<pmr::string> fields(resource);
+    
+    for (size_t i = first; i < first + count; ++i) {
+        string_view line = lines[i];
+        fields.clear();
+        while (!line.empty()) {
+            size_t space = line.find(' ');
+            fields.emplace_back(line.substr(0, space));
+            line = space == string_view::npos ? string_view() : line.substr(space + 1);
+        }
+        
+        int status = 0;
+        size_t latency = 0;
+        from_chars(fields[2].data(), fields[2].data() + fields[2].size(), status);
+        from_chars(fields[3].data(), fields[3].data() + fields[3].size(), latency);
+        
+        PathStats& stats = byPath[fields[1]];
+        ++stats.requests;
+        stats.errors += status >= 500;
+        stats.totalLatency += latency;
+    }
+    
+    size_t checksum = byPath.size();
+    for (const auto& [path, stats] : byPath) {
+        checksum += stats.requests * 31 + stats.errors * 7 + stats.totalLatency;
+    }
+    return checksum;
+}
+
+void demonstratePmrResources() {
+    cout << "\n=== Polymorphic Memory Resource Demo ===" << endl;
+    
+    {
+        StackAllocator<1024> stack;
+        StackMemoryResource<1024> resource(stack);
+        pmr::vector<int> values(&resource);
+        for (int i = 0; i < 64; ++i) {
+            values.push_back(i);
+        }
+        cout << "pmr::vector<int> on a 1 KB stack - size: " << values.size() 
+             << ", stack used: " << stack.getBytesUsed() 
+             << ", spilled upstream: " << resource.getUpstreamAllocations() << endl;
+    }
+    
+    // Zero-byte requests against full arenas must go upstream and come back
+    // to upstream, not be mistaken for a pointer one past the arena.
+    {
+        StackAllocator<64> stack;
+        StackMemoryResource<64> stackResource(stack);
+        void* filler = stackResource.allocate(64, 1);
+        void* empty = stackResource.allocate(0, 1);
+        assert(stack.owns(filler) && !stack.owns(empty) && stackResource.getUpstreamAllocations() == 1);
+        stackResource.deallocate(empty, 0, 1);
+        stackResource.deallocate(filler, 64, 1);
+        assert(stack.getBytesUsed() == 0);
+        
+        LinearAllocator arena(64);
+        LinearMemoryResource linearResource(arena);
+        filler = linearResource.allocate(64, 1);
+        empty = linearResource.allocate(0, 1);
+        assert(arena.owns(filler) && !arena.owns(empty) && linearResource.getUpstreamAllocations() == 1);
+        linearResource.deallocate(empty, 0, 1);
+        cout << "Zero-byte allocations from full arenas: served and freed upstream" << endl;
+    }
+    
+    const size_t requests = 200;
+    const size_t linesPerRequest = 2000;
+    
+    vector<string> lines;
+    lines.reserve(requests * linesPerRequest);
+    mt19937 rng(42);
+    const char* methods[] = {"GET", "POST", "PUT", "DELETE"};
+    for (size_t i = 0; i < requests * linesPerRequest; ++i) {
+        lines.push_back(string(methods[rng() % 4]) + " /api/v1/customers/" + to_string(rng() % 500) +
+                        "/orders " + to_string(rng() % 10 < 9 ? 200 : 503) + " " + to_string(rng() % 400));
+    }
+    
+    auto runAll = [&](auto&& perRequest) {
+        size_t checksum = 0;
+        auto start = chrono::high_resolution_clock::now();
+        for (size_t r = 0; r < requests; ++r) {
+            checksum += perRequest(r * linesPerRequest);
+        }
+        auto end = chrono::high_resolution_clock::now();
+        return make_pair(chrono::duration<double, milli>(end - start).count(), checksum);
+    };
+    
+    auto [heapMs, heapSum] = runAll([&](size_t first) {
+        return aggregateRequest(lines, first, linesPerRequest, pmr::new_delete_resource());
+    });
+    
+    LinearAllocator arena(4 << 20);
+    size_t arenaSpills = 0;
+    auto [arenaMs, arenaSum] = runAll([&](size_t first) {
+        size_t checksum;
+        {
+            LinearMemoryResource resource(arena);
+            checksum = aggregateRequest(lines, first, linesPerRequest, &resource);
+            arenaSpills += resource.getUpstreamAllocations();
+        }
+        arena.reset();
+        return checksum;
+    });
+    
+    PoolMemoryResource<128> pool;
+    auto [poolMs, poolSum] = runAll([&](size_t first) {
+        return aggregateRequest(lines, first, linesPerRequest, &pool);
+    });
+    
+    cout << "Parse-and-aggregate, " << requests << " requests x " << linesPerRequest << " lines:" << endl;
+    cout << "  default heap   : " << heapMs << " ms" << endl;
+    cout << "  request arena  : " << arenaMs << " ms (" << heapMs / arenaMs << "x, "
+         << arenaSpills << " upstream spills)" << endl;
+    cout << "  128 B pool     : " << poolMs << " ms (" << heapMs / poolMs << "x, "
+         << pool.getUpstreamAllocations() << " upstream allocations)" << endl;
+    cout << "Checksums " << (heapSum == arenaSum && heapSum == poolSum ? "match" : "DIFFER") << endl;
+}
+
 int main() {
     cout << "Advanced Memory Pool and Custom Allocators Demo" << endl;
     cout << "===============================================" << endl;
@@ -395,7 +2473,15 @@ int main() {
     
     demonstrateStackAllocator();
     demonstrateLinearAllocator();
+    demonstrateScopedArena();
+    demonstratePmrResources();
     performanceComparison();
+    concurrentPoolComparison();
+    demonstrateSlabAllocator();
+    demonstrateChunkReclamation();
+    demonstrateHugePages();
+    demonstrateSlotMap();
+    demonstrateIntrusivePtr();
     
     cout << "\n2. Memory Pool Stress Test:" << endl;
     {
@@ -10,123 +10,214 @@
 #include <condition_variable>
 #include <exception>
 #include <atomic>
+#include <optional>
+#include <variant>
+#include <type_traits>
+#include <fstream>
+#include <string>
+#include <limits>
+#include <algorithm>
 using namespace std;
 
+// Where continuations run. Futures never start threads of their own.
+class Executor {
+public:
+    virtual ~Executor() = default;
+    virtual void execute(function<void()> task) = 0;
+};
+
+// Runs the continuation on whichever thread completed the future.
+class InlineExecutor : public Executor {
+public:
+    void execute(function<void()> task) override {
+        task();
+    }
+    
+    static InlineExecutor& instance() {
+        static InlineExecutor executor;
+        return executor;
+    }
+};
+
+template<typename T> class Future;
+
+template<typename T>
+struct UnwrapFuture {
+    using type = T;
+    static constexpr bool nested = false;
+};
+
+template<typename T>
+struct UnwrapFuture<Future<T>> {
+    using type = T;
+    static constexpr bool nested = true;
+};
+
+// Copyable handle to a shared result slot. Instead of a thread blocking on
+// get() per continuation, callbacks registered with onComplete() are kept in
+// the shared state and run exactly once by whoever completes it.
 template<typename T>
 class Future {
 private:
-    shared_ptr<promise<T>> prom;
-    shared_future<T> fut;
+    template<typename> friend class Future;
     
-public:
-    Future() : prom(make_shared<promise<T>>()) {
-        fut = prom->get_future().share();
-    }
+    using Stored = conditional_t<is_void_v<T>, monostate, T>;
     
-    template<typename U>
-    Future(U&& value) : prom(make_shared<promise<T>>()) {
-        fut = prom->get_future().share();
-        prom->set_value(forward<U>(value));
-    }
+    struct SharedState {
+        mutex stateMutex;
+        condition_variable readyCondition;
+        bool ready = false;
+        optional<Stored> value;
+        exception_ptr error;
+        vector<function<void(Future&)>> continuations;
+    };
     
-    template<typename Func>
-    auto then(Func&& func) -> Future<decltype(func(declval<T>()))> {
-        using ReturnType = decltype(func(declval<T>()));
-        
-        auto nextFuture = Future<ReturnType>();
-        
-        thread([fut = this->fut, func = forward<Func>(func), nextProm = nextFuture.prom]() {
-            try {
-                if constexpr (is_void_v<ReturnType>) {
-                    func(fut.get());
-                    nextProm->set_value();
-                } else {
-                    auto result = func(fut.get());
-                    nextProm->set_value(result);
-                }
-            } catch (...) {
-                nextProm->set_exception(current_exception());
-            }
-        }).detach();
-        
-        return nextFuture;
-    }
+    shared_ptr<SharedState> state;
     
-    T get() {
-        return fut.get();
+    template<typename Setter>
+    void complete(Setter&& setter) {
+        vector<function<void(Future&)>> callbacks;
+        {
+            lock_guard<mutex> lock(state->stateMutex);
+            if (state->ready) {
+                throw future_error(future_errc::promise_already_satisfied);
+            }
+            setter(*state);
+            state->ready = true;
+            callbacks.swap(state->continuations);
+        }
+        state->readyCondition.notify_all();
+        for (auto& callback : callbacks) {
+            callback(*this);
+        }
     }
     
-    bool isReady() const {
-        return fut.wait_for(chrono::seconds(0)) == future_status::ready;
+    template<typename Func>
+    static decltype(auto) invokeWith(Func& func, SharedState& s) {
+        if constexpr (is_void_v<T>) {
+            return func();
+        } else {
+            return func(*s.value);
+        }
     }
     
-    template<typename Rep, typename Period>
-    future_status waitFor(const chrono::duration<Rep, Period>& timeout) {
-        return fut.wait_for(timeout);
+    // Completes this future with the outcome of another one once it is ready.
+    template<typename U>
+    void completeFrom(Future<U> source) {
+        source.onComplete([target = *this](Future<U>& done) mutable {
+            if (done.state->error) {
+                target.setException(done.state->error);
+            } else if constexpr (is_void_v<U>) {
+                target.setValue();
+            } else {
+                target.setValue(*done.state->value);
+            }
+        });
     }
     
-    void setValue(T value) {
-        prom->set_value(value);
-    }
+public:
+    Future() : state(make_shared<SharedState>()) {}
     
-    void setException(exception_ptr exc) {
-        prom->set_exception(exc);
+    template<typename U, typename = enable_if_t<!is_same_v<decay_t<U>, Future>>>
+    Future(U&& value) : state(make_shared<SharedState>()) {
+        setValue(forward<U>(value));
     }
-};
-
-template<>
-class Future<void> {
-private:
-    shared_ptr<promise<void>> prom;
-    shared_future<void> fut;
     
-public:
-    Future() : prom(make_shared<promise<void>>()) {
-        fut = prom->get_future().share();
+    // Runs callback once the future is ready: immediately on the calling thread
+    // if it already is, otherwise on the thread that completes it. The callback
+    // is handed the completed future; capturing this future instead would make
+    // its state own itself and leak whenever it never completes.
+    void onComplete(function<void(Future&)> callback) {
+        {
+            lock_guard<mutex> lock(state->stateMutex);
+            if (!state->ready) {
+                state->continuations.push_back(move(callback));
+                return;
+            }
+        }
+        callback(*this);
     }
     
+    // Schedules func on executor once this future is ready. A func that returns
+    // a Future is flattened, so then() chains never yield Future<Future<U>>.
+    // The executor is held by reference and must outlive the pending chain; if
+    // it refuses the task, the returned future fails with its exception.
     template<typename Func>
-    auto then(Func&& func) -> Future<decltype(func())> {
-        using ReturnType = decltype(func());
-        
-        auto nextFuture = Future<ReturnType>();
+    auto then(Executor& executor, Func&& func) {
+        using ReturnType = decltype(invokeWith(func, *state));
+        using Unwrapped = UnwrapFuture<ReturnType>;
         
-        thread([fut = this->fut, func = forward<Func>(func), nextProm = nextFuture.prom]() {
-            try {
-                fut.get();
-                if constexpr (is_void_v<ReturnType>) {
-                    func();
-                    nextProm->set_value();
-                } else {
-                    auto result = func();
-                    nextProm->set_value(result);
+        Future<typename Unwrapped::type> next;
+        onComplete([next, &executor, func = forward<Func>(func)](Future& done) mutable {
+            auto run = [s = done.state, next, func = move(func)]() mutable {
+                if (s->error) {
+                    next.setException(s->error);
+                    return;
+                }
+                try {
+                    if constexpr (Unwrapped::nested) {
+                        next.completeFrom(invokeWith(func, *s));
+                    } else if constexpr (is_void_v<ReturnType>) {
+                        invokeWith(func, *s);
+                        next.setValue();
+                    } else {
+                        next.setValue(invokeWith(func, *s));
+                    }
+                } catch (...) {
+                    next.setException(current_exception());
                 }
+            };
+            try {
+                executor.execute(move(run));
             } catch (...) {
-                nextProm->set_exception(current_exception());
+                next.setException(current_exception());
             }
-        }).detach();
-        
-        return nextFuture;
+        });
+        return next;
     }
     
-    void get() {
-        fut.get();
+    template<typename Func>
+    auto then(Func&& func) {
+        return then(InlineExecutor::instance(), forward<Func>(func));
+    }
+    
+    T get() {
+        unique_lock<mutex> lock(state->stateMutex);
+        state->readyCondition.wait(lock, [this] { return state->ready; });
+        if (state->error) {
+            rethrow_exception(state->error);
+        }
+        if constexpr (!is_void_v<T>) {
+            return *state->value;
+        }
     }
     
     bool isReady() const {
-        return fut.wait_for(chrono::seconds(0)) == future_status::ready;
+        lock_guard<mutex> lock(state->stateMutex);
+        return state->ready;
     }
     
-    void setValue() {
-        prom->set_value();
+    template<typename Rep, typename Period>
+    future_status waitFor(const chrono::duration<Rep, Period>& timeout) {
+        unique_lock<mutex> lock(state->stateMutex);
+        bool ready = state->readyCondition.wait_for(lock, timeout, [this] { return state->ready; });
+        return ready ? future_status::ready : future_status::timeout;
+    }
+    
+    void setValue(Stored value) requires (!is_void_v<T>) {
+        complete([&value](SharedState& s) { s.value.emplace(move(value)); });
+    }
+    
+    void setValue() requires is_void_v<T> {
+        complete([](SharedState& s) { s.value.emplace(); });
     }
     
     void setException(exception_ptr exc) {
-        prom->set_exception(exc);
+        complete([&exc](SharedState& s) { s.error = move(exc); });
     }
 };
 
-class AsyncTaskRunner {
+class AsyncTaskRunner : public Executor {
 private:
     vector<thread> workers;
     queue<function<void()>> tasks;
@@ -181,6 +272,22 @@ public:
         return result;
     }
     
+    void execute(function<void()> task) override {
+        {
+            unique_lock<mutex> lock(taskMutex);
+            if (stopping) {
+                throw runtime_error("AsyncTaskRunner is stopping");
+            }
+            tasks.push(move(task));
+        }
+        
+        taskCondition.notify_one();
+    }
+    
+    size_t workerCount() const {
+        return workers.size();
+    }
+    
     ~AsyncTaskRunner() {
         {
             unique_lock<mutex> lock(taskMutex);
@@ -195,51 +302,76 @@ public:
     }
 };
 
+// Completes once every input has, or as soon as one fails. Each input gets a
+// callback that fills its slot and counts down; the last one assembles the
+// result. No thread waits on any of the inputs.
 template<typename T>
-Future<vector<T>> whenAll(vector<Future<T>>& futures) {
-    auto resultFuture = Future<vector<T>>();
+Future<vector<T>> whenAll(const vector<Future<T>>& futures) {
+    struct State {
+        vector<optional<T>> slots;
+        atomic<size_t> remaining;
+        atomic<bool> failed{false};
+        Future<vector<T>> result;
+        
+        explicit State(size_t n) : slots(n), remaining(n) {}
+    };
     
-    thread([futures = move(futures), resultProm = resultFuture.prom]() mutable {
-        try {
-            vector<T> results;
-            results.reserve(futures.size());
-            
-            for (auto& fut : futures) {
-                results.push_back(fut.get());
+    auto state = make_shared<State>(futures.size());
+    Future<vector<T>> result = state->result;
+    if (futures.empty()) {
+        result.setValue({});
+        return result;
+    }
+    
+    for (size_t i = 0; i < futures.size(); ++i) {
+        Future<T> fut = futures[i];
+        fut.onComplete([state, i](Future<T>& done) {
+            try {
+                state->slots[i].emplace(done.get());
+            } catch (...) {
+                if (!state->failed.exchange(true)) {
+                    state->result.setException(current_exception());
+                }
             }
-            
-            resultProm->set_value(move(results));
-        } catch (...) {
-            resultProm->set_exception(current_exception());
-        }
-    }).detach();
+            if (state->remaining.fetch_sub(1, memory_order_acq_rel) == 1 && !state->failed.load()) {
+                vector<T> values;
+                values.reserve(state->slots.size());
+                for (auto& slot : state->slots) {
+                    values.push_back(move(*slot));
+                }
+                state->result.setValue(move(values));
+            }
+        });
+    }
     
-    return resultFuture;
+    return result;
 }
 
+// Completes with the first input to finish, value or exception.
 template<typename T>
-Future<T> whenAny(vector<Future<T>>& futures) {
-    auto resultFuture = Future<T>();
-    auto completed = make_shared<atomic<bool>>(false);
+Future<T> whenAny(const vector<Future<T>>& futures) {
+    Future<T> result;
+    if (futures.empty()) {
+        result.setException(make_exception_ptr(invalid_argument("whenAny of no futures")));
+        return result;
+    }
     
-    for (auto& fut : futures) {
-        thread([fut = move(fut), resultProm = resultFuture.prom, completed]() mutable {
+    auto completed = make_shared<atomic<bool>>(false);
+    for (const Future<T>& input : futures) {
+        Future<T> fut = input;
+        fut.onComplete([result, completed](Future<T>& done) mutable {
+            if (completed->exchange(true)) {
+                return;
+            }
             try {
-                T result = fut.get();
-                bool expected = false;
-                if (completed->compare_exchange_strong(expected, true)) {
-                    resultProm->set_value(result);
-                }
+                result.setValue(done.get());
             } catch (...) {
-                bool expected = false;
-                if (completed->compare_exchange_strong(expected, true)) {
-                    resultProm->set_exception(current_exception());
-                }
+                result.setException(current_exception());
             }
-        }).detach();
+        });
     }
     
-    return resultFuture;
+    return result;
 }
 
 class AsyncHttpSimulator {
@@ -431,6 +563,89 @@ void demonstrateParallelComputations() {
     cout << "Used " << numChunks << " threads" << endl;
 }
 
+// Threads in this process, from /proc on Linux; 0 where that is unavailable.
+size_t processThreadCount() {
+    ifstream status("/proc/self/status");
+    string key;
+    while (status >> key) {
+        if (key == "Threads:") {
+            size_t count = 0;
+            status >> count;
+            return count;
+        }
+        status.ignore(numeric_limits<streamsize>::max(), '\n');
+    }
+    return 0;
+}
+
+void demonstrateFanOut() {
+    cout << "\n=== 100k-Way Fan-Out with Continuation Combinators ===" << endl;
+    
+    const size_t fanOut = 100000;
+    AsyncTaskRunner runner(4);
+    size_t threadsBefore = processThreadCount();
+    
+    auto start = chrono::high_resolution_clock::now();
+    
+    vector<Future<long long>> inputs(fanOut);
+    auto total = whenAll(inputs).then(runner, [](const vector<long long>& values) {
+        long long sum = 0;
+        for (long long v : values) {
+            sum += v;
+        }
+        return sum;
+    });
+    auto first = whenAny(inputs);
+    
+    size_t peakThreads = threadsBefore;
+    for (size_t i = 0; i < fanOut; ++i) {
+        runner.execute([input = inputs[i], i]() mutable {
+            input.setValue(static_cast<long long>(i));
+        });
+        if (i % 10000 == 0) {
+            peakThreads = max(peakThreads, processThreadCount());
+        }
+    }
+    
+    long long sum = total.get();
+    auto end = chrono::high_resolution_clock::now();
+    peakThreads = max(peakThreads, processThreadCount());
+    
+    cout << "whenAll sum: " << sum << " (expected " << static_cast<long long>(fanOut) * (fanOut - 1) / 2 << ")" << endl;
+    cout << "whenAny first value: " << first.get() << endl;
+    cout << "Time: " << chrono::duration_cast<chrono::milliseconds>(end - start).count() << " ms" << endl;
+    cout << "Threads before: " << threadsBefore << ", peak during fan-out: " << peakThreads 
+         << " (" << runner.workerCount() << " runner workers)" << endl;
+    
+    vector<Future<int>> partial(3);
+    auto failed = whenAll(partial);
+    partial[1].setException(make_exception_ptr(runtime_error("input 1 failed")));
+    try {
+        failed.get();
+    } catch (const exception& e) {
+        cout << "whenAll failed early with the other inputs still pending: " << e.what() << endl;
+    }
+    partial[0].setValue(0);
+    partial[2].setValue(2);
+    
+    // Inputs that never complete are simply released with their combinators.
+    vector<Future<int>> abandoned(2);
+    whenAll(abandoned);
+    whenAny(abandoned);
+    
+    struct ClosedExecutor : Executor {
+        void execute(function<void()>) override {
+            throw runtime_error("executor is closed");
+        }
+    } closed;
+    auto rejected = Future<int>(1).then(closed, [](int x) { return x + 1; });
+    try {
+        rejected.get();
+    } catch (const exception& e) {
+        cout << "then() on a closed executor: " << e.what() << endl;
+    }
+}
+
 int main() {
     cout << "Advanced Asynchronous Programming Demo" << endl;
     cout << "=====================================" << endl;
@@ -440,6 +655,7 @@ int main() {
     demonstrateTaskRunner();
     demonstrateHttpSimulation();
     demonstrateParallelComputations();
+    demonstrateFanOut();
     
     cout << "\n=== Exception Handling in Async Context ===" << endl;
     
@@ -3,56 +3,894 @@
 #include <vector>
 #include <queue>
 #include <functional>
+#include <list>
 #include <mutex>
 #include <condition_variable>
 #include <future>
 #include <atomic>
 #include <chrono>
+#include <memory>
+#include <random>
+#include <cstdint>
+#include <array>
+#include <algorithm>
+#include <cstdlib>
+#include <cmath>
+#include <numeric>
+#include <new>
+#include <type_traits>
+#include <utility>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
 using namespace std;
 
+// Build with -DCOUNT_ALLOCATIONS to have section 6 report heap allocations
+// per task. Counting means replacing the global operator new, so it is opt-in.
+#ifdef COUNT_ALLOCATIONS
+static atomic<size_t> heapAllocations{0};
+
+// Out of line so GCC cannot see malloc() and free() meet through inlining and warn.
+[[gnu::noinline]] void* operator new(size_t size) {
+    heapAllocations.fetch_add(1, memory_order_relaxed);
+    if (void* ptr = malloc(size)) {
+        return ptr;
+    }
+    throw bad_alloc();
+}
+
+[[gnu::noinline]] void operator delete(void* ptr) noexcept { free(ptr); }
+[[gnu::noinline]] void operator delete(void* ptr, size_t) noexcept { free(ptr); }
+#endif
+
+// Move-only replacement for function<void()>: callables up to INLINE_BYTES
+// that move without throwing are stored in place, so submitting a small lambda
+// allocates nothing. Larger callables fall back to a single heap allocation.
+class InlineTask {
+public:
+    // Sized so a queued task (this, its enqueue timestamp and gate) fills one 64-byte line.
+    static constexpr size_t INLINE_BYTES = 40;
+    
+private:
+    struct Ops {
+        void (*invoke)(void* storage);
+        void (*relocate)(void* to, void* from);   // move-construct into to, destroy from
+        void (*destroy)(void* storage);
+    };
+    
+    template<typename F>
+    static constexpr bool fitsInline = sizeof(F) <= INLINE_BYTES && alignof(F) <= alignof(max_align_t) &&
+                                       is_nothrow_move_constructible_v<F>;
+    
+    template<typename F>
+    static constexpr Ops inlineOps = {
+        [](void* storage) { (*static_cast<F*>(storage))(); },
+        [](void* to, void* from) {
+            new (to) F(move(*static_cast<F*>(from)));
+            static_cast<F*>(from)->~F();
+        },
+        [](void* storage) { static_cast<F*>(storage)->~F(); }
+    };
+    
+    template<typename F>
+    static constexpr Ops heapOps = {
+        [](void* storage) { (**static_cast<F**>(storage))(); },
+        [](void* to, void* from) { *static_cast<F**>(to) = *static_cast<F**>(from); },
+        [](void* storage) { delete *static_cast<F**>(storage); }
+    };
+    
+    alignas(max_align_t) unsigned char storage[INLINE_BYTES];
+    const Ops* ops;
+    
+public:
+    InlineTask() noexcept : ops(nullptr) {}
+    
+    template<typename F, typename Callable = decay_t<F>,
+             typename = enable_if_t<!is_same_v<Callable, InlineTask>>>
+    InlineTask(F&& f) {
+        if constexpr (fitsInline<Callable>) {
+            new (storage) Callable(forward<F>(f));
+            ops = &inlineOps<Callable>;
+        } else {
+            *reinterpret_cast<Callable**>(storage) = new Callable(forward<F>(f));
+            ops = &heapOps<Callable>;
+        }
+    }
+    
+    InlineTask(InlineTask&& other) noexcept : ops(other.ops) {
+        if (ops) {
+            ops->relocate(storage, other.storage);
+            other.ops = nullptr;
+        }
+    }
+    
+    InlineTask& operator=(InlineTask&& other) noexcept {
+        if (this != &other) {
+            reset();
+            if (other.ops) {
+                other.ops->relocate(storage, other.storage);
+                ops = other.ops;
+                other.ops = nullptr;
+            }
+        }
+        return *this;
+    }
+    
+    InlineTask(const InlineTask&) = delete;
+    InlineTask& operator=(const InlineTask&) = delete;
+    
+    ~InlineTask() {
+        reset();
+    }
+    
+    void reset() noexcept {
+        if (ops) {
+            ops->destroy(storage);
+            ops = nullptr;
+        }
+    }
+    
+    void operator()() {
+        ops->invoke(storage);
+    }
+    
+    explicit operator bool() const noexcept { return ops != nullptr; }
+};
+
+struct TaskGate;
+
+struct QueuedTask {
+    InlineTask task;
+    chrono::steady_clock::time_point enqueuedAt;
+    TaskGate* gate = nullptr;   // set for ThreadPool::schedule tasks, owned by the task
+};
+
+// FIFO ring of tasks that keeps its buffer between bursts, unlike queue over
+// deque, which frees and reallocates blocks as it drains and refills.
+class TaskRing {
+private:
+    vector<QueuedTask> slots;
+    size_t head;
+    size_t count;
+    
+public:
+    explicit TaskRing(size_t capacity = 256) : slots(capacity), head(0), count(0) {}
+    
+    void reserve(size_t capacity) {
+        if (capacity <= slots.size()) {
+            return;
+        }
+        vector<QueuedTask> bigger(capacity);
+        for (size_t i = 0; i < count; ++i) {
+            bigger[i] = move(slots[(head + i) % slots.size()]);
+        }
+        slots = move(bigger);
+        head = 0;
+    }
+    
+    void push(InlineTask task, chrono::steady_clock::time_point now, TaskGate* gate = nullptr) {
+        if (count == slots.size()) {
+            reserve(slots.size() * 2);
+        }
+        QueuedTask& entry = slots[(head + count) % slots.size()];
+        entry.task = move(task);
+        entry.enqueuedAt = now;
+        entry.gate = gate;
+        ++count;
+    }
+    
+    const QueuedTask& front() const { return slots[head]; }
+    
+    QueuedTask pop() {
+        QueuedTask task = move(slots[head]);
+        head = (head + 1) % slots.size();
+        --count;
+        return task;
+    }
+    
+    bool empty() const { return count == 0; }
+    size_t size() const { return count; }
+};
+
+struct CompletionSlotStore;
+
+// Pool-owned completion state for ThreadPool::submit, recycled through a free
+// list instead of allocating a future's shared state per task. Shared by the
+// running task and the TaskHandle; whichever lets go last returns it.
+struct CompletionSlot {
+    static constexpr size_t RESULT_BYTES = 64;
+    
+    atomic<uint32_t> ready{0};
+    atomic<uint32_t> references{0};
+    alignas(max_align_t) unsigned char result[RESULT_BYTES];
+    void (*destroyResult)(void*) = nullptr;
+    exception_ptr error;
+    CompletionSlotStore* store = nullptr;
+    CompletionSlot* nextFree = nullptr;
+    
+    template<typename R>
+    static constexpr bool fits = [] {
+        if constexpr (is_void_v<R>) {
+            return true;
+        } else {
+            return sizeof(R) <= RESULT_BYTES && alignof(R) <= alignof(max_align_t);
+        }
+    }();
+    
+    inline void release();
+};
+
+// Chunks of completion slots and their free list. The pool and every
+// outstanding TaskHandle share ownership, so a handle may outlive its pool.
+struct CompletionSlotStore {
+    mutex slotMutex;
+    CompletionSlot* freeSlots = nullptr;
+    vector<unique_ptr<CompletionSlot[]>> chunks;
+    
+    CompletionSlot* acquire() {
+        lock_guard<mutex> lock(slotMutex);
+        if (!freeSlots) {
+            const size_t chunkSize = 256;
+            chunks.push_back(make_unique<CompletionSlot[]>(chunkSize));
+            for (size_t i = 0; i < chunkSize; ++i) {
+                chunks.back()[i].store = this;
+                chunks.back()[i].nextFree = freeSlots;
+                freeSlots = &chunks.back()[i];
+            }
+        }
+        CompletionSlot* slot = freeSlots;
+        freeSlots = slot->nextFree;
+        slot->ready.store(0, memory_order_relaxed);
+        slot->references.store(2, memory_order_relaxed);
+        return slot;
+    }
+    
+    void recycle(CompletionSlot* slot) {
+        if (slot->destroyResult) {
+            slot->destroyResult(slot->result);
+            slot->destroyResult = nullptr;
+        }
+        slot->error = nullptr;
+        lock_guard<mutex> lock(slotMutex);
+        slot->nextFree = freeSlots;
+        freeSlots = slot;
+    }
+};
+
+void CompletionSlot::release() {
+    if (references.fetch_sub(1, memory_order_acq_rel) == 1) {
+        store->recycle(this);
+    }
+}
+
+// Result of ThreadPool::submit. Move-only. Keeps the slot store alive, so it
+// stays valid after the pool is destroyed; the pool runs every queued task
+// before it shuts down, so the result is always delivered.
+template<typename R>
+class TaskHandle {
+private:
+    CompletionSlot* slot;
+    shared_ptr<CompletionSlotStore> store;
+    
+    // Drop the slot before the store reference that keeps it alive.
+    void reset() noexcept {
+        if (slot) {
+            exchange(slot, nullptr)->release();
+        }
+        store.reset();
+    }
+    
+public:
+    TaskHandle(CompletionSlot* s, shared_ptr<CompletionSlotStore> owner) noexcept : slot(s), store(move(owner)) {}
+    TaskHandle(TaskHandle&& other) noexcept : slot(exchange(other.slot, nullptr)), store(move(other.store)) {}
+    TaskHandle& operator=(TaskHandle&& other) noexcept {
+        if (this != &other) {
+            reset();
+            slot = exchange(other.slot, nullptr);
+            store = move(other.store);
+        }
+        return *this;
+    }
+    TaskHandle(const TaskHandle&) = delete;
+    TaskHandle& operator=(const TaskHandle&) = delete;
+    
+    ~TaskHandle() {
+        reset();
+    }
+    
+    bool ready() const { return slot->ready.load(memory_order_acquire) != 0; }
+    
+    void wait() const {
+        slot->ready.wait(0, memory_order_acquire);
+    }
+    
+    // Waits, then moves the result out (or rethrows the task's exception). Call once.
+    R get() {
+        wait();
+        if (slot->error) {
+            rethrow_exception(slot->error);
+        }
+        if constexpr (!is_void_v<R>) {
+            return move(*launder(reinterpret_cast<R*>(slot->result)));
+        }
+    }
+};
+
+enum class TaskPriority { High, Normal, Low };
+constexpr size_t PRIORITY_LEVELS = 3;
+
+const char* priorityName(TaskPriority priority) {
+    switch (priority) {
+        case TaskPriority::High: return "high";
+        case TaskPriority::Normal: return "normal";
+        case TaskPriority::Low: return "low";
+    }
+    return "?";
+}
+
+struct TaskCancelled : runtime_error {
+    TaskCancelled() : runtime_error("task cancelled before it ran") {}
+};
+
+struct TaskExpired : runtime_error {
+    TaskExpired() : runtime_error("task deadline passed before it ran") {}
+};
+
+struct CancellationState {
+    atomic<bool> cancelled{false};
+    mutex callbackMutex;
+    list<function<void()>> callbacks;   // a list so registrations can unlink themselves
+};
+
+// Unregisters an onCancel callback when reset or destroyed, so a long-lived
+// token does not collect a callback for every task that ever used it.
+class CancellationRegistration {
+private:
+    shared_ptr<CancellationState> state;
+    list<function<void()>>::iterator entry;
+    
+public:
+    CancellationRegistration() = default;
+    CancellationRegistration(shared_ptr<CancellationState> s, list<function<void()>>::iterator e)
+        : state(move(s)), entry(e) {}
+    
+    CancellationRegistration(CancellationRegistration&& other) noexcept
+        : state(move(other.state)), entry(other.entry) {}
+    
+    CancellationRegistration& operator=(CancellationRegistration&& other) noexcept {
+        if (this != &other) {
+            reset();
+            state = move(other.state);
+            entry = other.entry;
+        }
+        return *this;
+    }
+    
+    ~CancellationRegistration() {
+        reset();
+    }
+    
+    void reset() {
+        if (!state) {
+            return;
+        }
+        {
+            lock_guard<mutex> lock(state->callbackMutex);
+            // Once cancelled, cancel() owns the callbacks and has run or is running them.
+            if (!state->cancelled.load(memory_order_relaxed)) {
+                state->callbacks.erase(entry);
+            }
+        }
+        state.reset();
+    }
+};
+
+// Cooperative cancellation: cancel() runs the registered callbacks at once,
+// which is how the pool fails the futures of queued tasks, and long-running
+// tasks can poll the token themselves.
+class CancellationToken {
+private:
+    shared_ptr<CancellationState> state;
+    
+public:
+    CancellationToken() = default;
+    explicit CancellationToken(shared_ptr<CancellationState> s) : state(move(s)) {}
+    
+    bool isCancelled() const {
+        return state && state->cancelled.load(memory_order_acquire);
+    }
+    
+    // Runs callback on cancel(), or right away if that already happened. The
+    // callback stays registered until the returned registration is reset.
+    [[nodiscard]] CancellationRegistration onCancel(function<void()> callback) const {
+        if (!state) {
+            return {};
+        }
+        {
+            lock_guard<mutex> lock(state->callbackMutex);
+            if (!state->cancelled.load(memory_order_relaxed)) {
+                state->callbacks.push_back(move(callback));
+                return CancellationRegistration(state, prev(state->callbacks.end()));
+            }
+        }
+        callback();
+        return {};
+    }
+};
+
+class CancellationSource {
+private:
+    shared_ptr<CancellationState> state = make_shared<CancellationState>();
+    
+public:
+    CancellationToken token() const { return CancellationToken(state); }
+    
+    size_t getCallbackCount() const {
+        lock_guard<mutex> lock(state->callbackMutex);
+        return state->callbacks.size();
+    }
+    
+    void cancel() {
+        list<function<void()>> callbacks;
+        {
+            lock_guard<mutex> lock(state->callbackMutex);
+            if (state->cancelled.exchange(true, memory_order_acq_rel)) {
+                return;
+            }
+            callbacks.swap(state->callbacks);
+        }
+        for (auto& callback : callbacks) {
+            callback();
+        }
+    }
+};
+
+// Decides the fate of a scheduled task exactly once, either when a worker
+// dequeues it or when its token is cancelled, whichever comes first.
+struct TaskGate {
+    enum class Verdict { Run, Cancelled, Expired, AlreadyResolved };
+    
+    atomic<bool> decided{false};
+    Verdict verdict = Verdict::Run;
+    chrono::steady_clock::time_point deadline;
+    CancellationToken token;
+    
+    // Called by the dequeuing worker under queueMutex.
+    Verdict admit(chrono::steady_clock::time_point now) {
+        if (decided.exchange(true, memory_order_acq_rel)) {
+            return verdict = Verdict::AlreadyResolved;
+        }
+        if (token.isCancelled()) {
+            return verdict = Verdict::Cancelled;
+        }
+        if (now > deadline) {
+            return verdict = Verdict::Expired;
+        }
+        return verdict = Verdict::Run;
+    }
+    
+    // Claims the task for the cancellation callback; false if a worker got there first.
+    bool claimForCancel() {
+        return !decided.exchange(true, memory_order_acq_rel);
+    }
+};
+
+struct TaskOptions {
+    TaskPriority priority = TaskPriority::Normal;
+    chrono::steady_clock::time_point deadline = chrono::steady_clock::time_point::max();
+    CancellationToken token;
+};
+
+// Log-linear latency histogram: 8 linear sub-buckets per power of two, so any
+// percentile is reported within 12.5% of the true value.
+class LatencyHistogram {
+private:
+    static constexpr size_t SUB_BUCKETS = 8;
+    static constexpr size_t BUCKETS = 64 * SUB_BUCKETS;
+    
+    array<uint64_t, BUCKETS> counts{};
+    uint64_t total = 0;
+    uint64_t maxValue = 0;
+    
+    static size_t bucketFor(uint64_t value) {
+        if (value < SUB_BUCKETS) {
+            return value;
+        }
+        int exponent = 63 - __builtin_clzll(value);
+        size_t sub = (value >> (exponent - 3)) & (SUB_BUCKETS - 1);
+        return (exponent - 2) * SUB_BUCKETS + sub;
+    }
+    
+    static uint64_t upperBound(size_t bucket) {
+        if (bucket < SUB_BUCKETS) {
+            return bucket;
+        }
+        int exponent = static_cast<int>(bucket / SUB_BUCKETS) + 2;
+        uint64_t sub = bucket % SUB_BUCKETS;
+        return ((SUB_BUCKETS + sub + 1) << (exponent - 3)) - 1;
+    }
+    
+public:
+    void record(uint64_t value) {
+        ++counts[bucketFor(value)];
+        ++total;
+        maxValue = max(maxValue, value);
+    }
+    
+    uint64_t count() const { return total; }
+    uint64_t maxRecorded() const { return maxValue; }
+    
+    uint64_t percentile(double p) const {
+        if (total == 0) {
+            return 0;
+        }
+        uint64_t rank = static_cast<uint64_t>(ceil(p / 100.0 * total));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < BUCKETS; ++i) {
+            seen += counts[i];
+            if (seen >= std::max<uint64_t>(rank, 1)) {
+                return min(upperBound(i), maxValue);
+            }
+        }
+        return maxValue;
+    }
+};
+
+inline void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#else
+    this_thread::yield();
+#endif
+}
+
+struct ThreadPoolConfig {
+    size_t minWorkers = 1;
+    size_t maxWorkers = max<size_t>(1, thread::hardware_concurrency());
+    // A worker above minWorkers that finds no work for this long exits.
+    chrono::milliseconds idleTimeout = chrono::milliseconds(200);
+    // Upper bound on pause iterations before parking. Spinning only helps
+    // when another core can produce work meanwhile.
+    size_t maxSpin = thread::hardware_concurrency() > 1 ? 4096 : 0;
+    bool pinWorkers = false;
+};
+
 class ThreadPool {
 private:
-    vector<thread> workers;
-    queue<function<void()>> tasks;
+    struct Worker {
+        thread handle;
+        atomic<bool> exited{false};
+    };
+    
+    ThreadPoolConfig config;
+    mutex workersMutex;
+    vector<unique_ptr<Worker>> workers;
+    size_t nextWorkerIndex = 0;
+    
+    array<TaskRing, PRIORITY_LEVELS> queues;
+    // Written under queueMutex; spinning workers poll it without the lock.
+    atomic<size_t> queuedCount{0};
     mutex queueMutex;
     condition_variable condition;
     atomic<bool> stop;
     
-public:
-    ThreadPool(size_t numThreads) : stop(false) {
-        for (size_t i = 0; i < numThreads; ++i) {
-            workers.emplace_back([this] {
-                while (true) {
-                    function<void()> task;
+    // Worker accounting, written under queueMutex.
+    atomic<size_t> liveWorkers{0};
+    size_t parkedWorkers = 0;
+    atomic<size_t> spinningWorkers{0};
+    
+    // Queueing latency per priority, recorded under queueMutex at dequeue.
+    array<LatencyHistogram, PRIORITY_LEVELS> latency;
+    chrono::nanoseconds agingInterval = chrono::milliseconds(10);
+    array<chrono::steady_clock::time_point, PRIORITY_LEVELS> lastAgedPick{};
+    atomic<size_t> cancelledTasks{0};
+    atomic<size_t> expiredTasks{0};
+    
+    shared_ptr<CompletionSlotStore> slots = make_shared<CompletionSlotStore>();
+    
+    // Caller holds queueMutex. Grows the pool while queued work outnumbers
+    // the workers that are free to take it, and reserves the new slots.
+    size_t reserveNewWorkers() {
+        size_t available = parkedWorkers + spinningWorkers.load(memory_order_relaxed);
+        size_t queued = queuedCount.load(memory_order_relaxed);
+        size_t live = liveWorkers.load(memory_order_relaxed);
+        if (queued <= available || live >= config.maxWorkers) {
+            return 0;
+        }
+        size_t grow = min(queued - available, config.maxWorkers - live);
+        liveWorkers.store(live + grow, memory_order_relaxed);
+        return grow;
+    }
+    
+    // Caller holds queueMutex. A spinning worker will pick the task up on its
+    // own, so the futex wake is only paid when the spinners are outnumbered.
+    bool needsWake() const {
+        return parkedWorkers > 0 && queuedCount.load(memory_order_relaxed) > spinningWorkers.load(memory_order_relaxed);
+    }
+    
+    // Starts the workers reserved by reserveNewWorkers. Once the destructor
+    // has set stop they would never be joined, so the reservation is undone.
+    void spawnWorkers(size_t count) {
+        lock_guard<mutex> lock(workersMutex);
+        if (stop.load(memory_order_acquire)) {
+            lock_guard<mutex> queueLock(queueMutex);
+            liveWorkers.fetch_sub(count, memory_order_relaxed);
+            return;
+        }
+        for (auto it = workers.begin(); it != workers.end();) {
+            if ((*it)->exited.load(memory_order_acquire)) {
+                (*it)->handle.join();
+                it = workers.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        for (size_t i = 0; i < count; ++i) {
+            auto worker = make_unique<Worker>();
+            worker->handle = thread(&ThreadPool::workerLoop, this, worker.get(), nextWorkerIndex++);
+            workers.push_back(move(worker));
+        }
+    }
+    
+    void pinToCpu([[maybe_unused]] size_t index) {
+#ifdef __linux__
+        size_t cpus = max<unsigned>(1, thread::hardware_concurrency());
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(index % cpus, &set);
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#endif
+    }
+    
+    // Spin for a budget that doubles when spinning caught work and halves when
+    // it did not, then park on the condition variable. Workers above
+    // minWorkers that stay parked for idleTimeout retire.
+    void workerLoop(Worker* self, size_t index) {
+        if (config.pinWorkers) {
+            pinToCpu(index);
+        }
+        
+        size_t spinBudget = min<size_t>(config.maxSpin, 64);
+        while (true) {
+            if (spinBudget > 0 && queuedCount.load(memory_order_relaxed) == 0) {
+                spinningWorkers.fetch_add(1, memory_order_relaxed);
+                size_t spins = 0;
+                while (spins < spinBudget && queuedCount.load(memory_order_relaxed) == 0 && !stop.load(memory_order_relaxed)) {
+                    cpuRelax();
+                    ++spins;
+                }
+                spinningWorkers.fetch_sub(1, memory_order_relaxed);
+                if (spins < spinBudget) {
+                    spinBudget = min(config.maxSpin, spinBudget * 2);
+                } else {
+                    spinBudget = max<size_t>(16, spinBudget / 2);
+                }
+            }
+            
+            QueuedTask next;
+            
+            {
+                unique_lock<mutex> lock(queueMutex);
+                if (!stop && queuedCount.load(memory_order_relaxed) == 0) {
+                    ++parkedWorkers;
+                    bool woken = condition.wait_for(lock, config.idleTimeout, [this] { 
+                        return stop || queuedCount.load(memory_order_relaxed) > 0; 
+                    });
+                    --parkedWorkers;
                     
-                    {
-                        unique_lock<mutex> lock(queueMutex);
-                        condition.wait(lock, [this] { return stop || !tasks.empty(); });
-                        
-                        if (stop && tasks.empty()) {
-                            return;
-                        }
-                        
-                        task = move(tasks.front());
-                        tasks.pop();
+                    if (!woken && liveWorkers.load(memory_order_relaxed) > config.minWorkers) {
+                        liveWorkers.fetch_sub(1, memory_order_relaxed);
+                        self->exited.store(true, memory_order_release);
+                        return;
                     }
-                    
-                    task();
                 }
-            });
+                
+                if (queuedCount.load(memory_order_relaxed) == 0) {
+                    if (stop) {
+                        return;
+                    }
+                    continue;
+                }
+                
+                next = popNext();
+            }
+            
+            next.task();
+        }
+    }
+    
+    void push(InlineTask task, TaskPriority priority = TaskPriority::Normal, TaskGate* gate = nullptr) {
+        auto now = chrono::steady_clock::now();
+        size_t grow;
+        bool wake;
+        {
+            unique_lock<mutex> lock(queueMutex);
+            
+            if (stop) {
+                throw runtime_error("enqueue on stopped ThreadPool");
+            }
+            
+            queues[static_cast<size_t>(priority)].push(move(task), now, gate);
+            queuedCount.fetch_add(1, memory_order_relaxed);
+            wake = needsWake();
+            grow = reserveNewWorkers();
+        }
+        
+        if (wake) {
+            condition.notify_one();
+        }
+        if (grow > 0) {
+            spawnWorkers(grow);
         }
     }
     
+    // Highest priority wins, except that a lower level whose head has waited
+    // longer than agingInterval gets one turn per interval. That keeps a flood
+    // of high-priority work from starving the rest while costing high-priority
+    // tasks at most one extra task per interval. Caller holds queueMutex.
+    QueuedTask popNext() {
+        auto now = chrono::steady_clock::now();
+        size_t best = PRIORITY_LEVELS;
+        for (size_t level = PRIORITY_LEVELS; level-- > 1;) {
+            if (!queues[level].empty() && now - queues[level].front().enqueuedAt > agingInterval &&
+                now - lastAgedPick[level] > agingInterval) {
+                lastAgedPick[level] = now;
+                best = level;
+                break;
+            }
+        }
+        for (size_t level = 0; best == PRIORITY_LEVELS; ++level) {
+            if (!queues[level].empty()) {
+                best = level;
+            }
+        }
+        
+        QueuedTask next = queues[best].pop();
+        queuedCount.fetch_sub(1, memory_order_relaxed);
+        // Dropped tasks never ran, so they stay out of the latency figures.
+        if (!next.gate || next.gate->admit(now) == TaskGate::Verdict::Run) {
+            latency[best].record(chrono::duration_cast<chrono::nanoseconds>(now - next.enqueuedAt).count());
+        }
+        return next;
+    }
+    
+public:
+    ThreadPool(size_t numThreads) : ThreadPool(ThreadPoolConfig{numThreads, numThreads}) {}
+    
+    explicit ThreadPool(const ThreadPoolConfig& cfg) : config(cfg), stop(false) {
+        config.minWorkers = max<size_t>(1, config.minWorkers);
+        config.maxWorkers = max(config.minWorkers, config.maxWorkers);
+        liveWorkers.store(config.minWorkers, memory_order_relaxed);
+        spawnWorkers(config.minWorkers);
+    }
+    
     template<typename F, typename... Args>
-    auto enqueue(F&& f, Args&&... args) -> future<typename result_of<F(Args...)>::type> {
-        using return_type = typename result_of<F(Args...)>::type;
+    auto enqueue(F&& f, Args&&... args) -> future<invoke_result_t<F, Args...>> {
+        using return_type = invoke_result_t<F, Args...>;
         
         auto task = make_shared<packaged_task<return_type()>>(
             bind(forward<F>(f), forward<Args>(args)...)
         );
         
         future<return_type> result = task->get_future();
+        push([task]() { (*task)(); });
+        return result;
+    }
+    
+    // Fire-and-forget: no completion state at all.
+    template<typename F, typename... Args>
+    void post(F&& f, Args&&... args) {
+        push([f = forward<F>(f), ...args = forward<Args>(args)]() mutable {
+            invoke(f, args...);
+        });
+    }
+    
+    // Like enqueue, but the completion state comes from a recycled pool slot,
+    // so a small task with a small result allocates nothing in steady state.
+    template<typename F, typename... Args>
+    auto submit(F&& f, Args&&... args) -> TaskHandle<invoke_result_t<F, Args...>> {
+        using return_type = invoke_result_t<F, Args...>;
+        static_assert(CompletionSlot::fits<return_type>, "result too large for a completion slot; use enqueue()");
+        
+        CompletionSlot* slot = slots->acquire();
+        TaskHandle<return_type> handle(slot, slots);
+        auto task = [slot, f = forward<F>(f), ...args = forward<Args>(args)]() mutable {
+            try {
+                if constexpr (is_void_v<return_type>) {
+                    invoke(f, args...);
+                } else {
+                    new (slot->result) return_type(invoke(f, args...));
+                    slot->destroyResult = [](void* result) { static_cast<return_type*>(result)->~return_type(); };
+                }
+            } catch (...) {
+                slot->error = current_exception();
+            }
+            slot->ready.store(1, memory_order_release);
+            slot->ready.notify_all();
+            slot->release();
+        };
+        try {
+            push(move(task));
+        } catch (...) {
+            // The task will never run, so drop its reference here; the handle
+            // drops the other one as the exception unwinds.
+            slot->release();
+            throw;
+        }
+        return handle;
+    }
+    
+    // Like enqueue, with a priority, a deadline and a cancellation token.
+    // Cancelling the token fails the future with TaskCancelled immediately if
+    // the task is still queued; a task whose deadline has passed when a worker
+    // picks it up is dropped and its future throws TaskExpired. A task that has
+    // started can only notice cancellation by polling the token.
+    template<typename F, typename... Args>
+    auto schedule(const TaskOptions& options, F&& f, Args&&... args) -> future<invoke_result_t<F, Args...>> {
+        using return_type = invoke_result_t<F, Args...>;
+        
+        struct Scheduled : TaskGate {
+            promise<return_type> completion;
+            CancellationRegistration registration;
+        };
         
+        auto scheduled = make_shared<Scheduled>();
+        scheduled->deadline = options.deadline;
+        scheduled->token = options.token;
+        future<return_type> result = scheduled->completion.get_future();
+        
+        scheduled->registration = options.token.onCancel([this, weak = weak_ptr<Scheduled>(scheduled)] {
+            auto pending = weak.lock();
+            if (pending && pending->claimForCancel()) {
+                cancelledTasks.fetch_add(1, memory_order_relaxed);
+                pending->completion.set_exception(make_exception_ptr(TaskCancelled()));
+            }
+        });
+        
+        TaskGate* gate = scheduled.get();
+        push([this, scheduled = move(scheduled), f = forward<F>(f), ...args = forward<Args>(args)]() mutable {
+            // The verdict is in, so the cancel callback has nothing left to do.
+            scheduled->registration.reset();
+            promise<return_type>& completion = scheduled->completion;
+            switch (scheduled->verdict) {
+                case TaskGate::Verdict::AlreadyResolved:
+                    return;
+                case TaskGate::Verdict::Cancelled:
+                    cancelledTasks.fetch_add(1, memory_order_relaxed);
+                    completion.set_exception(make_exception_ptr(TaskCancelled()));
+                    return;
+                case TaskGate::Verdict::Expired:
+                    expiredTasks.fetch_add(1, memory_order_relaxed);
+                    completion.set_exception(make_exception_ptr(TaskExpired()));
+                    return;
+                case TaskGate::Verdict::Run:
+                    break;
+            }
+            try {
+                if constexpr (is_void_v<return_type>) {
+                    invoke(f, args...);
+                    completion.set_value();
+                } else {
+                    completion.set_value(invoke(f, args...));
+                }
+            } catch (...) {
+                completion.set_exception(current_exception());
+            }
+        }, options.priority, gate);
+        return result;
+    }
+    
+    // Posts every callable in the range under a single lock and wakes all
+    // workers once, instead of a lock and notify_one per task. Callables are
+    // moved out of an rvalue range and copied from an lvalue one.
+    template<typename Range>
+    void enqueueBulk(Range&& range) {
+        size_t pushed = 0;
+        size_t grow = 0;
+        bool wake = false;
         {
             unique_lock<mutex> lock(queueMutex);
             
@@ -60,11 +898,104 @@ public:
                 throw runtime_error("enqueue on stopped ThreadPool");
             }
             
-            tasks.emplace([task]() { (*task)(); });
+            TaskRing& tasks = queues[static_cast<size_t>(TaskPriority::Normal)];
+            if constexpr (requires { std::size(range); }) {
+                tasks.reserve(tasks.size() + std::size(range));
+            }
+            auto now = chrono::steady_clock::now();
+            for (auto&& f : range) {
+                if constexpr (is_rvalue_reference_v<Range&&>) {
+                    tasks.push(InlineTask(move(f)), now);
+                } else {
+                    tasks.push(InlineTask(f), now);
+                }
+                ++pushed;
+            }
+            queuedCount.fetch_add(pushed, memory_order_relaxed);
+            wake = needsWake();
+            grow = reserveNewWorkers();
         }
         
-        condition.notify_one();
-        return result;
+        if (wake) {
+            if (pushed == 1) {
+                condition.notify_one();
+            } else {
+                condition.notify_all();
+            }
+        }
+        if (grow > 0) {
+            spawnWorkers(grow);
+        }
+    }
+    
+    // Runs fn(i) for every i in [begin, end) and returns when all are done.
+    // Helpers and the calling thread claim chunks from a shared cursor; chunks
+    // start at a share of the remaining range and shrink toward grain, so
+    // uneven iterations still balance. Safe to call from inside a task: the
+    // caller can finish the whole range without any helper running.
+    template<typename Index, typename F>
+    void parallelFor(Index begin, Index end, Index grain, F&& fn) {
+        if (!(begin < end)) {
+            return;
+        }
+        
+        struct Loop {
+            atomic<size_t> next{0};
+            atomic<size_t> completed{0};
+            atomic<bool> failed{false};
+            exception_ptr error;
+            size_t total;
+            size_t grain;
+            size_t helpers;
+        };
+        
+        auto loop = make_shared<Loop>();
+        loop->total = static_cast<size_t>(end - begin);
+        loop->grain = max<size_t>(1, static_cast<size_t>(grain));
+        loop->helpers = min(config.maxWorkers, (loop->total + loop->grain - 1) / loop->grain);
+        
+        // Helpers may start after the caller has already finished the range,
+        // so they share ownership of the loop state and never touch fn then.
+        auto runChunks = [loop, begin, &fn]() {
+            while (true) {
+                size_t start = loop->next.load(memory_order_relaxed);
+                size_t length;
+                do {
+                    if (start >= loop->total) {
+                        return;
+                    }
+                    size_t remaining = loop->total - start;
+                    length = min(remaining, max(loop->grain, remaining / (2 * (loop->helpers + 1))));
+                } while (!loop->next.compare_exchange_weak(start, start + length, memory_order_relaxed));
+                
+                try {
+                    for (size_t i = start; i < start + length; ++i) {
+                        fn(static_cast<Index>(begin + static_cast<Index>(i)));
+                    }
+                } catch (...) {
+                    if (!loop->failed.exchange(true)) {
+                        loop->error = current_exception();
+                    }
+                }
+                
+                if (loop->completed.fetch_add(length, memory_order_acq_rel) + length == loop->total) {
+                    loop->completed.notify_all();
+                }
+            }
+        };
+        
+        vector<decltype(runChunks)> helperTasks(loop->helpers, runChunks);
+        enqueueBulk(move(helperTasks));
+        runChunks();
+        
+        size_t done;
+        while ((done = loop->completed.load(memory_order_acquire)) < loop->total) {
+            loop->completed.wait(done, memory_order_acquire);
+        }
+        
+        if (loop->error) {
+            rethrow_exception(loop->error);
+        }
     }
     
     ~ThreadPool() {
@@ -75,6 +1006,320 @@ public:
         
         condition.notify_all();
         
+        // Join outside workersMutex: a task still running may be inside push()
+        // on its way to spawnWorkers(), which needs the lock to see stop.
+        vector<unique_ptr<Worker>> joining;
+        {
+            lock_guard<mutex> lock(workersMutex);
+            joining.swap(workers);
+        }
+        for (auto& worker : joining) {
+            worker->handle.join();
+        }
+    }
+    
+    size_t getWorkerCount() const {
+        return liveWorkers.load(memory_order_relaxed);
+    }
+    
+    void setAgingInterval(chrono::nanoseconds interval) {
+        lock_guard<mutex> lock(queueMutex);
+        agingInterval = max(interval, chrono::nanoseconds(1));
+    }
+    
+    LatencyHistogram queueLatency(TaskPriority priority) {
+        lock_guard<mutex> lock(queueMutex);
+        return latency[static_cast<size_t>(priority)];
+    }
+    
+    void resetLatencyStats() {
+        lock_guard<mutex> lock(queueMutex);
+        latency = {};
+    }
+    
+    size_t getCancelledCount() const { return cancelledTasks.load(memory_order_relaxed); }
+    size_t getExpiredCount() const { return expiredTasks.load(memory_order_relaxed); }
+};
+
+// Chase-Lev work-stealing deque. The owning worker pushes and pops at the
+// bottom without locks; other workers steal from the top, and a CAS on top
+// settles the race for the last element. Grows by copying into a larger ring;
+// old rings are kept until the deque dies because thieves may still read them.
+template<typename T>
+class WorkStealingDeque {
+private:
+    struct Ring {
+        size_t capacity;
+        unique_ptr<atomic<T>[]> slots;
+        
+        explicit Ring(size_t cap) : capacity(cap), slots(new atomic<T>[cap]) {}
+        
+        T get(int64_t index) const { return slots[index & (capacity - 1)].load(memory_order_relaxed); }
+        void put(int64_t index, T value) { slots[index & (capacity - 1)].store(value, memory_order_relaxed); }
+    };
+    
+    alignas(64) atomic<int64_t> top;
+    alignas(64) atomic<int64_t> bottom;
+    atomic<Ring*> ring;
+    vector<unique_ptr<Ring>> rings;   // owner only
+    
+    Ring* grow(Ring* old, int64_t t, int64_t b) {
+        rings.push_back(make_unique<Ring>(old->capacity * 2));
+        Ring* bigger = rings.back().get();
+        for (int64_t i = t; i < b; ++i) {
+            bigger->put(i, old->get(i));
+        }
+        ring.store(bigger, memory_order_release);
+        return bigger;
+    }
+    
+public:
+    explicit WorkStealingDeque(size_t capacity = 1024) : top(0), bottom(0) {
+        rings.push_back(make_unique<Ring>(capacity));
+        ring.store(rings.back().get(), memory_order_relaxed);
+    }
+    
+    // Owner only.
+    void push(T value) {
+        int64_t b = bottom.load(memory_order_relaxed);
+        int64_t t = top.load(memory_order_acquire);
+        Ring* r = ring.load(memory_order_relaxed);
+        if (b - t > static_cast<int64_t>(r->capacity) - 1) {
+            r = grow(r, t, b);
+        }
+        r->put(b, value);
+        bottom.store(b + 1, memory_order_release);
+    }
+    
+    // Owner only. Returns T() when empty.
+    T pop() {
+        int64_t b = bottom.load(memory_order_relaxed) - 1;
+        Ring* r = ring.load(memory_order_relaxed);
+        bottom.store(b, memory_order_relaxed);
+        atomic_thread_fence(memory_order_seq_cst);
+        int64_t t = top.load(memory_order_relaxed);
+        
+        if (t > b) {
+            bottom.store(b + 1, memory_order_relaxed);
+            return T();
+        }
+        
+        T value = r->get(b);
+        if (t == b) {
+            // Last element: race any thief for it.
+            if (!top.compare_exchange_strong(t, t + 1, memory_order_seq_cst, memory_order_relaxed)) {
+                value = T();
+            }
+            bottom.store(b + 1, memory_order_relaxed);
+        }
+        return value;
+    }
+    
+    // Any thread. Returns T() when empty or when it lost a race.
+    T steal() {
+        int64_t t = top.load(memory_order_acquire);
+        atomic_thread_fence(memory_order_seq_cst);
+        int64_t b = bottom.load(memory_order_acquire);
+        
+        if (t >= b) {
+            return T();
+        }
+        
+        T value = ring.load(memory_order_acquire)->get(t);
+        if (!top.compare_exchange_strong(t, t + 1, memory_order_seq_cst, memory_order_relaxed)) {
+            return T();
+        }
+        return value;
+    }
+    
+    bool empty() const {
+        return bottom.load(memory_order_relaxed) <= top.load(memory_order_relaxed);
+    }
+};
+
+// Work-stealing pool: each worker owns a deque, tasks submitted from inside a
+// task go to the submitting worker's deque, idle workers steal from random
+// victims, and submissions from outside the pool go through a shared injection
+// queue. Workers that find nothing spin briefly and then park on a condition
+// variable, which submitters only touch when someone is actually parked.
+class WorkStealingPool {
+private:
+    using Task = function<void()>;
+    
+    struct alignas(64) Worker {
+        WorkStealingDeque<Task*> deque;
+        uint64_t random;
+    };
+    
+    vector<unique_ptr<Worker>> queues;
+    vector<thread> workers;
+    
+    mutex injectMutex;
+    queue<Task*> injected;
+    atomic<size_t> injectedCount;
+    
+    mutex sleepMutex;
+    condition_variable wake;
+    atomic<size_t> sleepers;
+    atomic<uint64_t> wakeEpoch;
+    atomic<bool> stop;
+    
+    static inline thread_local WorkStealingPool* currentPool = nullptr;
+    static inline thread_local size_t currentIndex = 0;
+    
+    Task* popInjected() {
+        if (injectedCount.load(memory_order_relaxed) == 0) {
+            return nullptr;
+        }
+        lock_guard<mutex> lock(injectMutex);
+        if (injected.empty()) {
+            return nullptr;
+        }
+        Task* task = injected.front();
+        injected.pop();
+        injectedCount.fetch_sub(1, memory_order_relaxed);
+        return task;
+    }
+    
+    Task* stealFromOthers(Worker& self, size_t selfIndex) {
+        size_t count = queues.size();
+        self.random ^= self.random << 13;
+        self.random ^= self.random >> 7;
+        self.random ^= self.random << 17;
+        size_t start = self.random % count;
+        for (size_t i = 0; i < count; ++i) {
+            size_t victim = (start + i) % count;
+            if (victim == selfIndex) continue;
+            if (Task* task = queues[victim]->deque.steal()) {
+                return task;
+            }
+        }
+        return nullptr;
+    }
+    
+    Task* findWork(size_t index) {
+        Worker& self = *queues[index];
+        if (Task* task = self.deque.pop()) return task;
+        if (Task* task = popInjected()) return task;
+        return stealFromOthers(self, index);
+    }
+    
+    void wakeOne() {
+        atomic_thread_fence(memory_order_seq_cst);
+        if (sleepers.load(memory_order_relaxed) > 0) {
+            {
+                lock_guard<mutex> lock(sleepMutex);
+                wakeEpoch.fetch_add(1, memory_order_relaxed);
+            }
+            wake.notify_one();
+        }
+    }
+    
+    void run(Task* task) {
+        unique_ptr<Task> owned(task);
+        (*owned)();
+    }
+    
+    void workerLoop(size_t index) {
+        currentPool = this;
+        currentIndex = index;
+        
+        while (true) {
+            Task* task = nullptr;
+            for (int attempt = 0; attempt < 64 && !task; ++attempt) {
+                task = findWork(index);
+                if (!task && attempt >= 16) {
+                    this_thread::yield();
+                }
+            }
+            if (task) {
+                run(task);
+                continue;
+            }
+            
+            // Announce the intent to sleep before the final check, so a
+            // submitter either sees a sleeper or this check sees its task.
+            sleepers.fetch_add(1, memory_order_seq_cst);
+            uint64_t epoch = wakeEpoch.load(memory_order_relaxed);
+            atomic_thread_fence(memory_order_seq_cst);
+            task = findWork(index);
+            if (!task && !stop.load(memory_order_relaxed)) {
+                unique_lock<mutex> lock(sleepMutex);
+                wake.wait(lock, [&] {
+                    return wakeEpoch.load(memory_order_relaxed) != epoch || stop.load(memory_order_relaxed);
+                });
+            }
+            sleepers.fetch_sub(1, memory_order_relaxed);
+            
+            if (task) {
+                run(task);
+            } else if (stop.load(memory_order_relaxed)) {
+                // Drain whatever is left before exiting.
+                while ((task = findWork(index))) {
+                    run(task);
+                }
+                return;
+            }
+        }
+    }
+    
+public:
+    explicit WorkStealingPool(size_t numThreads)
+        : injectedCount(0), sleepers(0), wakeEpoch(0), stop(false) {
+        numThreads = max<size_t>(numThreads, 1);
+        for (size_t i = 0; i < numThreads; ++i) {
+            queues.push_back(make_unique<Worker>());
+            queues.back()->random = 0x9E3779B97F4A7C15ULL * (i + 1);
+        }
+        for (size_t i = 0; i < numThreads; ++i) {
+            workers.emplace_back([this, i] { workerLoop(i); });
+        }
+    }
+    
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+    
+    // Fire-and-forget submission.
+    template<typename F>
+    void post(F&& f) {
+        Task* task = new Task(forward<F>(f));
+        if (currentPool == this) {
+            queues[currentIndex]->deque.push(task);
+        } else {
+            lock_guard<mutex> lock(injectMutex);
+            if (stop) {
+                delete task;
+                throw runtime_error("post on stopped WorkStealingPool");
+            }
+            injected.push(task);
+            injectedCount.fetch_add(1, memory_order_relaxed);
+        }
+        wakeOne();
+    }
+    
+    template<typename F, typename... Args>
+    auto enqueue(F&& f, Args&&... args) -> future<invoke_result_t<F, Args...>> {
+        using return_type = invoke_result_t<F, Args...>;
+        
+        auto task = make_shared<packaged_task<return_type()>>(
+            bind(forward<F>(f), forward<Args>(args)...)
+        );
+        future<return_type> result = task->get_future();
+        post([task]() { (*task)(); });
+        return result;
+    }
+    
+    ~WorkStealingPool() {
+        {
+            lock_guard<mutex> lock(injectMutex);
+            stop = true;
+        }
+        {
+            lock_guard<mutex> lock(sleepMutex);
+            wakeEpoch.fetch_add(1, memory_order_relaxed);
+        }
+        wake.notify_all();
+        
         for (thread& worker : workers) {
             worker.join();
         }
@@ -110,6 +1355,349 @@ double calculatePi(int iterations) {
     return 4.0 * pi;
 }
 
+// Fine-grained scheduling benchmark: a few root tasks each submit a large
+// number of tiny tasks from inside the pool, which is where a single shared
+// queue turns into the bottleneck.
+template<typename Pool, typename F>
+void submitTo(Pool& pool, F&& f) {
+    if constexpr (requires { pool.post(f); }) {
+        pool.post(forward<F>(f));
+    } else {
+        pool.enqueue(forward<F>(f));
+    }
+}
+
+template<typename Pool>
+double tinyTaskThroughput(size_t threads, size_t totalTasks) {
+    atomic<size_t> completed{0};
+    auto start = chrono::high_resolution_clock::now();
+    {
+        Pool pool(threads);
+        size_t roots = threads * 4;
+        for (size_t r = 0; r < roots; ++r) {
+            size_t share = totalTasks / roots + (r < totalTasks % roots ? 1 : 0);
+            submitTo(pool, [&pool, &completed, share] {
+                for (size_t i = 0; i < share; ++i) {
+                    submitTo(pool, [&completed] { completed.fetch_add(1, memory_order_relaxed); });
+                }
+            });
+        }
+        while (completed.load(memory_order_relaxed) < totalTasks) {
+            this_thread::sleep_for(chrono::microseconds(200));
+        }
+    }
+    auto end = chrono::high_resolution_clock::now();
+    return chrono::duration<double, milli>(end - start).count();
+}
+
+void compareSchedulers() {
+    cout << "\n5. Work-Stealing vs Shared-Queue Scheduling:" << endl;
+    
+    const size_t totalTasks = 10000000;
+    // Beyond twice the core count this only measures oversubscription.
+    const size_t maxThreads = min<size_t>(64, max<size_t>(2, 2 * thread::hardware_concurrency()));
+    cout << "  " << totalTasks << " tiny tasks, submitted from inside the pool" << endl;
+    for (size_t threads = 1; threads <= maxThreads; threads *= 2) {
+        double sharedMs = tinyTaskThroughput<ThreadPool>(threads, totalTasks);
+        double stealingMs = tinyTaskThroughput<WorkStealingPool>(threads, totalTasks);
+        cout << "  " << threads << " threads - shared queue: " << sharedMs << " ms, work stealing: " 
+             << stealingMs << " ms (" << sharedMs / stealingMs << "x)" << endl;
+    }
+}
+
+// Times a batch once the pool's ring and slot free list have warmed up, and
+// with COUNT_ALLOCATIONS also reports heap allocations per task.
+template<typename Submit>
+void measureTaskOverhead(const char* label, ThreadPool& pool, size_t tasks, Submit submitBatch) {
+    submitBatch(pool, tasks);   // warm-up: grows the ring and the slot chunks
+#ifdef COUNT_ALLOCATIONS
+    size_t before = heapAllocations.load(memory_order_relaxed);
+#endif
+    auto start = chrono::high_resolution_clock::now();
+    submitBatch(pool, tasks);
+    auto end = chrono::high_resolution_clock::now();
+    cout << "  " << label << ": " << chrono::duration<double, milli>(end - start).count() << " ms";
+#ifdef COUNT_ALLOCATIONS
+    size_t after = heapAllocations.load(memory_order_relaxed);
+    cout << ", " << static_cast<double>(after - before) / tasks << " allocations/task";
+#endif
+    cout << endl;
+}
+
+void compareTaskOverhead() {
+    cout << "\n6. Per-Task Overhead: enqueue vs submit vs post:" << endl;
+    
+    const size_t tasks = 200000;
+    const size_t batch = 1000;
+    ThreadPool pool(4);
+    
+    measureTaskOverhead("enqueue (future + packaged_task)", pool, tasks, [batch](ThreadPool& p, size_t n) {
+        vector<future<int>> results;
+        results.reserve(batch);
+        for (size_t i = 0; i < n; i += batch) {
+            for (size_t j = 0; j < batch; ++j) {
+                results.push_back(p.enqueue([j] { return static_cast<int>(j); }));
+            }
+            for (auto& result : results) {
+                result.get();
+            }
+            results.clear();
+        }
+    });
+    measureTaskOverhead("submit (pooled completion slot)", pool, tasks, [batch](ThreadPool& p, size_t n) {
+        vector<TaskHandle<int>> results;
+        results.reserve(batch);
+        for (size_t i = 0; i < n; i += batch) {
+            for (size_t j = 0; j < batch; ++j) {
+                results.push_back(p.submit([j] { return static_cast<int>(j); }));
+            }
+            for (auto& result : results) {
+                result.get();
+            }
+            results.clear();
+        }
+    });
+    measureTaskOverhead("post (fire-and-forget)", pool, tasks, [](ThreadPool& p, size_t n) {
+        atomic<size_t> done{0};
+        for (size_t i = 0; i < n; ++i) {
+            p.post([&done] { done.fetch_add(1, memory_order_release); });
+        }
+        while (done.load(memory_order_acquire) < n) {
+            this_thread::yield();
+        }
+    });
+    
+    // A handle may outlive the pool that produced it.
+    TaskHandle<int> survivor = [] {
+        ThreadPool shortLived(1);
+        return shortLived.submit([] { return 42; });
+    }();
+    cout << "  handle read after its pool was destroyed: " << survivor.get() << endl;
+}
+
+void compareLoopStrategies() {
+    cout << "\n7. Data-Parallel Loops: enqueue vs enqueueBulk vs parallelFor:" << endl;
+    
+    const size_t n = 1000000;
+    vector<double> out(n);
+    ThreadPool pool(thread::hardware_concurrency());
+    auto body = [&out](size_t i) {
+        double x = static_cast<double>(i);
+        for (int k = 0; k < 16; ++k) {
+            x = sqrt(x + k) * 1.0001;
+        }
+        out[i] = x;
+    };
+    
+    auto timeIt = [&](const char* label, auto&& run) {
+        fill(out.begin(), out.end(), 0.0);
+        auto start = chrono::high_resolution_clock::now();
+        run();
+        auto end = chrono::high_resolution_clock::now();
+        cout << "  " << label << ": " << chrono::duration<double, milli>(end - start).count() 
+             << " ms (checksum " << accumulate(out.begin(), out.end(), 0.0) << ")" << endl;
+    };
+    
+    timeIt("serial loop         ", [&] {
+        for (size_t i = 0; i < n; ++i) {
+            body(i);
+        }
+    });
+    
+    timeIt("enqueue per element ", [&] {
+        vector<future<void>> results;
+        results.reserve(n);
+        for (size_t i = 0; i < n; ++i) {
+            results.push_back(pool.enqueue(body, i));
+        }
+        for (auto& result : results) {
+            result.wait();
+        }
+    });
+    
+    timeIt("enqueueBulk         ", [&] {
+        atomic<size_t> done{0};
+        auto task = [&body, &done](size_t i) {
+            return [&body, &done, i] {
+                body(i);
+                done.fetch_add(1, memory_order_release);
+            };
+        };
+        vector<decltype(task(0))> batch;
+        batch.reserve(n);
+        for (size_t i = 0; i < n; ++i) {
+            batch.push_back(task(i));
+        }
+        pool.enqueueBulk(move(batch));
+        while (done.load(memory_order_acquire) < n) {
+            this_thread::yield();
+        }
+    });
+    
+    timeIt("parallelFor grain 1 ", [&] { pool.parallelFor<size_t>(0, n, 1, body); });
+    timeIt("parallelFor grain 1K", [&] { pool.parallelFor<size_t>(0, n, 1024, body); });
+}
+
+void demonstratePriorities() {
+    cout << "\n8. Priorities, Deadlines and Cancellation Under Saturation:" << endl;
+    
+    ThreadPool pool(2);
+    pool.setAgingInterval(chrono::milliseconds(20));
+    
+    TaskOptions lowPriority;
+    lowPriority.priority = TaskPriority::Low;
+    TaskOptions highPriority;
+    highPriority.priority = TaskPriority::High;
+    
+    // Batch backlog: about 400 ms of work for two workers.
+    vector<future<void>> batch;
+    for (int i = 0; i < 4000; ++i) {
+        batch.push_back(pool.schedule(lowPriority, [] {
+            this_thread::sleep_for(chrono::microseconds(200));
+        }));
+    }
+    
+    // Cancel a slice of the backlog before it runs.
+    CancellationSource source;
+    vector<future<void>> cancellable;
+    for (int i = 0; i < 500; ++i) {
+        TaskOptions options;
+        options.priority = TaskPriority::Low;
+        options.token = source.token();
+        cancellable.push_back(pool.schedule(options, [] {
+            this_thread::sleep_for(chrono::microseconds(200));
+        }));
+    }
+    source.cancel();
+    
+    // Queued tasks are failed by cancel() itself, not when a worker reaches them.
+    auto cancelStart = chrono::steady_clock::now();
+    size_t cancelled = 0;
+    for (auto& task : cancellable) {
+        try {
+            task.get();
+        } catch (const TaskCancelled&) {
+            ++cancelled;
+        }
+    }
+    auto cancelWait = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - cancelStart);
+    
+    // Latency-critical requests, and low-priority requests that are useless
+    // after 5 ms but queue behind the batch backlog.
+    vector<future<int>> urgent;
+    vector<future<int>> timed;
+    for (int i = 0; i < 200; ++i) {
+        TaskOptions withDeadline;
+        withDeadline.priority = TaskPriority::Low;
+        withDeadline.deadline = chrono::steady_clock::now() + chrono::milliseconds(5);
+        urgent.push_back(pool.schedule(highPriority, [i] { return i; }));
+        timed.push_back(pool.schedule(withDeadline, [i] { 
+            this_thread::sleep_for(chrono::microseconds(100));
+            return i; 
+        }));
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+    
+    size_t expired = 0;
+    for (auto& task : timed) {
+        try {
+            task.get();
+        } catch (const TaskExpired&) {
+            ++expired;
+        }
+    }
+    for (auto& task : urgent) {
+        task.get();
+    }
+    for (auto& task : batch) {
+        task.get();
+    }
+    
+    cout << "  cancelled futures: " << cancelled << "/" << cancellable.size() 
+         << " (resolved " << cancelWait.count() << " us after cancel)"
+         << ", expired futures: " << expired << "/" << timed.size() << endl;
+    cout << "  queueing latency (us):" << endl;
+    for (TaskPriority priority : {TaskPriority::High, TaskPriority::Normal, TaskPriority::Low}) {
+        LatencyHistogram histogram = pool.queueLatency(priority);
+        cout << "    " << priorityName(priority) << ": n=" << histogram.count() 
+             << " p50=" << histogram.percentile(50) / 1000 << " p99=" << histogram.percentile(99) / 1000 
+             << " max=" << histogram.maxRecorded() / 1000 << endl;
+    }
+    
+    // A long-lived token, such as one per service, keeps no callbacks for
+    // tasks that have already run.
+    CancellationSource shutdown;
+    TaskOptions service;
+    service.token = shutdown.token();
+    vector<future<int>> served;
+    for (int i = 0; i < 1000; ++i) {
+        served.push_back(pool.schedule(service, [i] { return i; }));
+    }
+    for (auto& task : served) {
+        task.get();
+    }
+    cout << "  callbacks left on a long-lived token after " << served.size() << " tasks: " 
+         << shutdown.getCallbackCount() << endl;
+}
+
+// Median time from submitting a trivial task to it starting, with a short gap
+// between submissions so the workers go idle each time.
+double medianWakeLatencyUs(const ThreadPoolConfig& config) {
+    ThreadPool pool(config);
+    vector<double> samples;
+    for (int i = 0; i < 2000; ++i) {
+        auto submitted = chrono::steady_clock::now();
+        auto started = pool.submit([] { return chrono::steady_clock::now(); }).get();
+        samples.push_back(chrono::duration<double, micro>(started - submitted).count());
+        auto until = chrono::steady_clock::now() + chrono::microseconds(20);
+        while (chrono::steady_clock::now() < until) {}
+    }
+    nth_element(samples.begin(), samples.begin() + samples.size() / 2, samples.end());
+    return samples[samples.size() / 2];
+}
+
+void demonstrateElasticPool() {
+    cout << "\n9. Elastic Sizing, Spin-Then-Park and Affinity:" << endl;
+    
+    ThreadPoolConfig elastic;
+    elastic.minWorkers = 1;
+    elastic.maxWorkers = 8;
+    elastic.idleTimeout = chrono::milliseconds(50);
+    ThreadPool pool(elastic);
+    
+    cout << "  idle workers: " << pool.getWorkerCount() << endl;
+    vector<future<void>> burst;
+    size_t peak = 0;
+    for (int i = 0; i < 64; ++i) {
+        burst.push_back(pool.enqueue([] { this_thread::sleep_for(chrono::milliseconds(5)); }));
+        peak = max(peak, pool.getWorkerCount());
+    }
+    for (auto& task : burst) {
+        task.wait();
+        peak = max(peak, pool.getWorkerCount());
+    }
+    cout << "  workers during a 64-task burst: " << peak << endl;
+    this_thread::sleep_for(chrono::milliseconds(300));
+    cout << "  workers after 300 ms quiet: " << pool.getWorkerCount() << endl;
+    
+    ThreadPoolConfig parking;
+    parking.minWorkers = parking.maxWorkers = 2;
+    parking.maxSpin = 0;
+    ThreadPoolConfig spinning = parking;
+    spinning.maxSpin = 4096;
+    cout << "  median wake-up latency, park only: " << medianWakeLatencyUs(parking) << " us" << endl;
+    cout << "  median wake-up latency, spin then park: " << medianWakeLatencyUs(spinning) << " us";
+    cout << (thread::hardware_concurrency() > 1 ? "" : " (one core: spinning only delays the producer)") << endl;
+    
+    ThreadPoolConfig pinned;
+    pinned.minWorkers = pinned.maxWorkers = max<size_t>(1, thread::hardware_concurrency());
+    pinned.pinWorkers = true;
+    ThreadPool pinnedPool(pinned);
+    atomic<size_t> sum{0};
+    pinnedPool.parallelFor<size_t>(0, 100000, 1024, [&sum](size_t i) { sum.fetch_add(i, memory_order_relaxed); });
+    cout << "  pinned pool of " << pinnedPool.getWorkerCount() << " workers summed 0..99999 = " << sum.load() << endl;
+}
+
 int main() {
     cout << "Thread Pool Implementation Demo" << endl;
     cout << "===============================" << endl;
@@ -187,6 +1775,12 @@ int main() {
         cout << "  " << task.get() << endl;
     }
     
+    compareSchedulers();
+    compareTaskOverhead();
+    compareLoopStrategies();
+    demonstratePriorities();
+    demonstrateElasticPool();
+    
     cout << "\nAll tasks completed. Thread pool will be destroyed." << endl;
     return 0;
 }
\ No newline at end of file
@@ -4,18 +4,494 @@
 #include <string>
 #include <chrono>
 #include <new>
+#include <atomic>
+#include <cstdlib>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+#if __has_include(<execinfo.h>) && __has_include(<dlfcn.h>) && __has_include(<cxxabi.h>)
+#include <execinfo.h>
+#include <dlfcn.h>
+#include <cxxabi.h>
+#define PROFILER_HAS_BACKTRACE 1
+#endif
 using namespace std;
 
+// Opt-in heap profiler fed by the global operator new/delete below, which are
+// only replaced when built with -DPROFILE_ALLOCATIONS. Each thread counts into
+// its own table of call sites, so the hot path takes no locks and no shared
+// cache lines; report() merges the tables afterwards. A thread's table goes
+// back to a free list when the thread exits and is reused, counters and all,
+// by the next new thread, so thread churn does not grow the profiler.
+//
+// Like tcmalloc's heap profiler it samples by bytes: roughly one allocation per
+// sample interval is recorded, weighted to stand for the bytes in between, so
+// the unsampled fast path is a thread-local countdown. enable(1) records every
+// allocation exactly, which is the mode to use when hunting a specific leak.
+// The first sample from each site on a thread captures a stack for the folded
+// (flamegraph) output.
+class AllocationProfiler {
+public:
+    // Prepended to every block from the global operator new, enabled or not,
+    // so blocks allocated before enable() can still be freed afterwards.
+    struct alignas(16) Header {
+        const void* site;     // nullptr unless this allocation was sampled
+        size_t size;
+        size_t weight;        // bytes this sample stands for, at least size
+        int64_t birthMicros;  // 0 when the sample was not timed
+    };
+    
+    static constexpr size_t MAX_FRAMES = 16;
+    static constexpr size_t DEFAULT_SAMPLE_INTERVAL = 256 * 1024;
+    
+private:
+    struct SiteCounters {
+        atomic<const void*> site{nullptr};
+        atomic<uint64_t> allocations{0};
+        atomic<uint64_t> allocatedBytes{0};
+        atomic<uint64_t> frees{0};
+        atomic<uint64_t> freedBytes{0};
+        atomic<uint64_t> lifetimeSamples{0};
+        atomic<uint64_t> lifetimeMicros{0};
+        atomic<int> depth{0};
+        void* frames[MAX_FRAMES];
+    };
+    
+    // Single writer (the owning thread); report() reads it concurrently,
+    // which is why the counters are relaxed atomics rather than plain integers.
+    struct ThreadTable {
+        static constexpr size_t SLOTS = 1024;     // slot 0 collects sites that do not fit
+        SiteCounters sites[SLOTS];
+        atomic<int64_t> pendingLiveBytes{0};
+        uint64_t random = 0x2545F4914F6CDD1DULL;
+        uint32_t untimedSamples = 0;
+        atomic<bool> inUse{true};
+        ThreadTable* next = nullptr;
+    };
+    
+    // Hands the thread's table back when the thread exits.
+    struct TableLease {
+        ThreadTable* table;
+        bool released;
+        
+        constexpr TableLease() : table(nullptr), released(false) {}
+        
+        ~TableLease() {
+            if (table) {
+                table->inUse.store(false, memory_order_release);
+            }
+            released = true;
+        }
+    };
+    
+    static constexpr int64_t LIVE_FLUSH_BYTES = 16 * 1024;
+    
+    static inline atomic<bool> enabled{false};
+    static inline atomic<size_t> sampleInterval{DEFAULT_SAMPLE_INTERVAL};
+    static inline atomic<ThreadTable*> tables{nullptr};
+    static inline atomic<int64_t> liveBytes{0};
+    static inline atomic<int64_t> peakLiveBytes{0};
+    static inline const chrono::steady_clock::time_point epoch = chrono::steady_clock::now();
+    
+    static inline thread_local TableLease threadTable;
+    static inline thread_local int64_t bytesUntilSample = 0;
+    static inline thread_local bool busy = false;   // set while the profiler itself may allocate
+    
+    // Frees made by later thread_local destructors, after the lease is gone,
+    // are not recorded.
+    static ThreadTable* currentTable() {
+        if (threadTable.table || threadTable.released) {
+            return threadTable.table;
+        }
+        
+        // Tables are never freed so report() can read them after their thread
+        // exits; an idle one is reused before a new one is made.
+        for (ThreadTable* table = tables.load(memory_order_acquire); table; table = table->next) {
+            bool idle = false;
+            if (!table->inUse.load(memory_order_relaxed) &&
+                table->inUse.compare_exchange_strong(idle, true, memory_order_acquire, memory_order_relaxed)) {
+                return threadTable.table = table;
+            }
+        }
+        
+        // malloc rather than new: this runs inside operator new.
+        void* memory = malloc(sizeof(ThreadTable));
+        if (!memory) return nullptr;
+        ThreadTable* table = new (memory) ThreadTable();
+        table->next = tables.load(memory_order_relaxed);
+        while (!tables.compare_exchange_weak(table->next, table, memory_order_release, memory_order_relaxed)) {}
+        return threadTable.table = table;
+    }
+    
+    static SiteCounters& countersFor(ThreadTable& table, const void* site) {
+        size_t index = (reinterpret_cast<uintptr_t>(site) >> 4) * 0x9E3779B97F4A7C15ULL >> 54;
+        for (size_t probe = 0; probe < 16; ++probe) {
+            size_t slot = 1 + (index + probe) % (ThreadTable::SLOTS - 1);
+            SiteCounters& counters = table.sites[slot];
+            const void* current = counters.site.load(memory_order_relaxed);
+            if (current == site) {
+                return counters;
+            }
+            if (!current) {
+                counters.site.store(site, memory_order_release);
+                return counters;
+            }
+        }
+        return table.sites[0];
+    }
+    
+    static void bump(atomic<uint64_t>& counter, uint64_t amount) {
+        counter.store(counter.load(memory_order_relaxed) + amount, memory_order_relaxed);
+    }
+    
+    static int64_t nowMicros() {
+        return chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - epoch).count() + 1;
+    }
+    
+    static void raisePeak(int64_t live) {
+        int64_t peak = peakLiveBytes.load(memory_order_relaxed);
+        while (live > peak && !peakLiveBytes.compare_exchange_weak(peak, live, memory_order_relaxed)) {}
+    }
+    
+    // The global live-byte total is only touched every LIVE_FLUSH_BYTES of
+    // per-thread change, so a peak between flushes can be missed by up to that
+    // much per thread. getLiveBytes() adds the unflushed deltas back in.
+    static void adjustLive(ThreadTable& table, int64_t delta) {
+        int64_t pending = table.pendingLiveBytes.load(memory_order_relaxed) + delta;
+        if (pending >= LIVE_FLUSH_BYTES || pending <= -LIVE_FLUSH_BYTES) {
+            raisePeak(liveBytes.fetch_add(pending, memory_order_relaxed) + pending);
+            pending = 0;
+        }
+        table.pendingLiveBytes.store(pending, memory_order_relaxed);
+    }
+    
+    static string siteName(const void* site) {
+        if (!site) return "<other sites>";
+        string name = symbolize(site);
+        return name.size() > 100 ? name.substr(0, 97) + "..." : name;
+    }
+    
+    static string symbolize(const void* address) {
+        ostringstream out;
+#ifdef PROFILER_HAS_BACKTRACE
+        Dl_info info;
+        if (dladdr(address, &info)) {
+            if (info.dli_sname) {
+                int status = 0;
+                char* demangled = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+                out << (status == 0 ? demangled : info.dli_sname);
+                free(demangled);
+                return out.str();
+            }
+            if (info.dli_fname) {
+                string file = info.dli_fname;
+                out << file.substr(file.find_last_of('/') + 1) << "+0x" << hex
+                    << (reinterpret_cast<uintptr_t>(address) - reinterpret_cast<uintptr_t>(info.dli_fbase));
+                return out.str();
+            }
+        }
+#endif
+        out << address;
+        return out.str();
+    }
+    
+    static void recordSample(Header* header, const void* site) {
+        busy = true;
+        if (ThreadTable* table = currentTable()) {
+            // Next sample point is uniformly jittered around the interval so
+            // periodic allocation patterns cannot hide from it.
+            size_t interval = sampleInterval.load(memory_order_relaxed);
+            size_t size = header->size;
+            size_t weight = max(size, interval);
+            table->random ^= table->random << 13;
+            table->random ^= table->random >> 7;
+            table->random ^= table->random << 17;
+            bytesUntilSample = interval > 1 ? static_cast<int64_t>(interval / 2 + table->random % interval) : 0;
+            
+            SiteCounters& counters = countersFor(*table, site);
+            header->site = site;
+            header->weight = weight;
+            // Reading the clock costs more than the rest of a sample, so when
+            // every allocation is sampled only one in 16 is timed.
+            header->birthMicros = interval > 1 || ++table->untimedSamples % 16 == 0 ? nowMicros() : 0;
+            bump(counters.allocations, (weight + size / 2) / max<size_t>(size, 1));
+            bump(counters.allocatedBytes, weight);
+#ifdef PROFILER_HAS_BACKTRACE
+            if (counters.depth.load(memory_order_relaxed) == 0 && &counters != &table->sites[0]) {
+                counters.depth.store(backtrace(counters.frames, MAX_FRAMES), memory_order_release);
+            }
+#endif
+            adjustLive(*table, static_cast<int64_t>(weight));
+        }
+        busy = false;
+    }
+    
+    static void recordFree(const Header* header) {
+        busy = true;
+        if (ThreadTable* table = currentTable()) {
+            SiteCounters& counters = countersFor(*table, header->site);
+            bump(counters.frees, (header->weight + header->size / 2) / max<size_t>(header->size, 1));
+            bump(counters.freedBytes, header->weight);
+            if (header->birthMicros) {
+                bump(counters.lifetimeSamples, 1);
+                bump(counters.lifetimeMicros, static_cast<uint64_t>(nowMicros() - header->birthMicros));
+            }
+            adjustLive(*table, -static_cast<int64_t>(header->weight));
+        }
+        busy = false;
+    }
+    
+public:
+    struct SiteReport {
+        const void* site = nullptr;
+        uint64_t allocations = 0;
+        uint64_t allocatedBytes = 0;
+        uint64_t frees = 0;
+        uint64_t freedBytes = 0;
+        double averageLifetimeMicros = 0.0;
+        vector<void*> stack;      // innermost frame first
+        
+        int64_t liveBytes() const { return static_cast<int64_t>(allocatedBytes - freedBytes); }
+    };
+    
+    // sampleIntervalBytes of 1 records every allocation. Other threads pick up
+    // a new interval at their next sample.
+    static void enable(size_t sampleIntervalBytes = DEFAULT_SAMPLE_INTERVAL) {
+#ifdef PROFILER_HAS_BACKTRACE
+        // backtrace() loads the unwinder on first use, which allocates; do it up front.
+        void* warmup[1];
+        backtrace(warmup, 1);
+#endif
+        sampleInterval.store(max<size_t>(sampleIntervalBytes, 1), memory_order_relaxed);
+        bytesUntilSample = 0;
+        enabled.store(true, memory_order_relaxed);
+    }
+    
+    static void disable() { enabled.store(false, memory_order_relaxed); }
+    static bool isEnabled() { return enabled.load(memory_order_relaxed); }
+    
+    static void* allocate(size_t size, const void* site) {
+        Header* header = static_cast<Header*>(malloc(sizeof(Header) + size));
+        if (!header) return nullptr;
+        header->site = nullptr;
+        header->size = size;
+        
+        if (enabled.load(memory_order_relaxed) &&
+            (bytesUntilSample -= static_cast<int64_t>(size)) <= 0 && !busy) {
+            recordSample(header, site);
+        }
+        return header + 1;
+    }
+    
+    static void deallocate(void* ptr) {
+        if (!ptr) return;
+        Header* header = static_cast<Header*>(ptr) - 1;
+        
+        // Frees are attributed to the allocating site even when profiling has since been disabled.
+        if (header->site && !busy) {
+            recordFree(header);
+        }
+        free(header);
+    }
+    
+    // Per-site totals merged across every thread that ever allocated or freed.
+    static vector<SiteReport> collect() {
+        bool wasBusy = busy;
+        busy = true;
+        
+        struct Merged {
+            SiteReport report;
+            uint64_t lifetimeSamples = 0;
+            uint64_t lifetimeMicros = 0;
+        };
+        map<const void*, Merged> merged;
+        
+        for (ThreadTable* table = tables.load(memory_order_acquire); table; table = table->next) {
+            for (SiteCounters& counters : table->sites) {
+                const void* site = counters.site.load(memory_order_acquire);
+                if (!site && &counters != &table->sites[0]) continue;
+                
+                Merged& entry = merged[site];
+                SiteReport& report = entry.report;
+                report.site = site;
+                report.allocations += counters.allocations.load(memory_order_relaxed);
+                report.allocatedBytes += counters.allocatedBytes.load(memory_order_relaxed);
+                report.frees += counters.frees.load(memory_order_relaxed);
+                report.freedBytes += counters.freedBytes.load(memory_order_relaxed);
+                entry.lifetimeSamples += counters.lifetimeSamples.load(memory_order_relaxed);
+                entry.lifetimeMicros += counters.lifetimeMicros.load(memory_order_relaxed);
+                
+                int depth = counters.depth.load(memory_order_acquire);
+                if (report.stack.empty() && depth > 0) {
+                    report.stack.assign(counters.frames, counters.frames + depth);
+                }
+            }
+        }
+        
+        vector<SiteReport> result;
+        for (auto& [site, entry] : merged) {
+            if (entry.report.allocations == 0 && entry.report.frees == 0) continue;
+            if (entry.lifetimeSamples > 0) {
+                entry.report.averageLifetimeMicros = static_cast<double>(entry.lifetimeMicros) / entry.lifetimeSamples;
+            }
+            result.push_back(move(entry.report));
+        }
+        sort(result.begin(), result.end(), [](const SiteReport& a, const SiteReport& b) {
+            return a.allocatedBytes > b.allocatedBytes;
+        });
+        busy = wasBusy;
+        return result;
+    }
+    
+    // Same total as getLiveBytes(), but merged site by site.
+    static int64_t countLiveBytes() {
+        int64_t live = 0;
+        for (const SiteReport& site : collect()) {
+            live += site.liveBytes();
+        }
+        return live;
+    }
+    
+    static size_t getThreadTableCount() {
+        size_t count = 0;
+        for (ThreadTable* table = tables.load(memory_order_acquire); table; table = table->next) {
+            ++count;
+        }
+        return count;
+    }
+    
+    static int64_t getLiveBytes() {
+        int64_t live = liveBytes.load(memory_order_relaxed);
+        for (ThreadTable* table = tables.load(memory_order_acquire); table; table = table->next) {
+            live += table->pendingLiveBytes.load(memory_order_relaxed);
+        }
+        return live;
+    }
+    
+    // Never below the current live bytes, even when the peak fell between flushes.
+    static int64_t getPeakLiveBytes() {
+        raisePeak(getLiveBytes());
+        return peakLiveBytes.load(memory_order_relaxed);
+    }
+    
+    static void report(ostream& out, size_t topSites = 10) {
+        vector<SiteReport> sites = collect();
+        bool wasBusy = busy;
+        busy = true;
+        
+        uint64_t allocations = 0, bytes = 0;
+        for (const SiteReport& site : sites) {
+            allocations += site.allocations;
+            bytes += site.allocatedBytes;
+        }
+        out << "Allocation profile: " << allocations << " allocations, " << bytes << " bytes, peak live ~"
+            << getPeakLiveBytes() << " bytes, " << sites.size() << " call sites" << endl;
+        
+        for (size_t i = 0; i < min(topSites, sites.size()); ++i) {
+            const SiteReport& site = sites[i];
+            out << "  " << site.allocatedBytes << " B in " << site.allocations << " allocs, avg lifetime "
+                << site.averageLifetimeMicros << " us, live " << site.liveBytes() << " B  @ "
+                << siteName(site.site) << endl;
+        }
+        
+        bool leaks = false;
+        for (const SiteReport& site : sites) {
+            if (site.liveBytes() > 0) {
+                if (!leaks) out << "Still live (possible leaks):" << endl;
+                leaks = true;
+                out << "  " << site.liveBytes() << " B in " << site.allocations - site.frees << " blocks @ "
+                    << siteName(site.site) << endl;
+            }
+        }
+        busy = wasBusy;
+    }
+    
+    // One line per call site, outermost frame first, weighted by bytes allocated;
+    // feed to flamegraph.pl. Link with -rdynamic to get names for the executable's own frames.
+    static void writeFoldedStacks(ostream& out) {
+        vector<SiteReport> sites = collect();
+        bool wasBusy = busy;
+        busy = true;
+        
+        for (const SiteReport& site : sites) {
+            if (!site.site) continue;
+            string line;
+            // Skip the profiler's own frames: allocate() and operator new.
+            size_t skip = min<size_t>(2, site.stack.size());
+            for (size_t i = site.stack.size(); i > skip; --i) {
+                string frame = symbolize(site.stack[i - 1]);
+                replace(frame.begin(), frame.end(), ';', ':');
+                line += frame + ';';
+            }
+            if (line.empty()) line = symbolize(site.site) + ';';
+            line.back() = ' ';
+            out << line << site.allocatedBytes << '\n';
+        }
+        busy = wasBusy;
+    }
+    
+    // Prints the report to stderr at exit and, if given, writes folded stacks to foldedPath.
+    static void reportAtExit(const char* foldedPath = nullptr) {
+        static const char* path = nullptr;
+        path = foldedPath;
+        atexit([] {
+            disable();
+            report(cerr);
+            if (path) {
+                ofstream folded(path);
+                writeFoldedStacks(folded);
+            }
+        });
+    }
+};
+
+// Replaceable global allocation functions route through the profiler. The
+// over-aligned forms are left to the library, which pairs them with its own delete.
+#ifdef PROFILE_ALLOCATIONS
+void* operator new(size_t size) {
+    if (void* ptr = AllocationProfiler::allocate(size, __builtin_return_address(0))) return ptr;
+    throw bad_alloc();
+}
+
+void* operator new[](size_t size) {
+    if (void* ptr = AllocationProfiler::allocate(size, __builtin_return_address(0))) return ptr;
+    throw bad_alloc();
+}
+
+void* operator new(size_t size, const nothrow_t&) noexcept {
+    return AllocationProfiler::allocate(size, __builtin_return_address(0));
+}
+
+void* operator new[](size_t size, const nothrow_t&) noexcept {
+    return AllocationProfiler::allocate(size, __builtin_return_address(0));
+}
+
+void operator delete(void* ptr) noexcept { AllocationProfiler::deallocate(ptr); }
+void operator delete[](void* ptr) noexcept { AllocationProfiler::deallocate(ptr); }
+void operator delete(void* ptr, size_t) noexcept { AllocationProfiler::deallocate(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { AllocationProfiler::deallocate(ptr); }
+void operator delete(void* ptr, const nothrow_t&) noexcept { AllocationProfiler::deallocate(ptr); }
+void operator delete[](void* ptr, const nothrow_t&) noexcept { AllocationProfiler::deallocate(ptr); }
+#endif
+
+// Keeps exact counts of its own blocks; the profiler only sees a sample of them.
 class CustomAllocator {
 private:
     static size_t totalAllocated;
+    static size_t peakAllocated;
     static size_t allocationCount;
     
 public:
     static void* allocate(size_t size) {
-        void* ptr = malloc(size);
+        void* ptr = AllocationProfiler::allocate(size, __builtin_return_address(0));
         if (ptr) {
             totalAllocated += size;
+            peakAllocated = max(peakAllocated, totalAllocated);
             allocationCount++;
             cout << "Allocated " << size << " bytes at " << ptr << endl;
         }
@@ -27,17 +503,18 @@ public:
             totalAllocated -= size;
             allocationCount--;
             cout << "Deallocated " << size << " bytes at " << ptr << endl;
-            free(ptr);
+            AllocationProfiler::deallocate(ptr);
         }
     }
     
     static void printStats() {
-        cout << "Memory Stats - Total: " << totalAllocated 
-             << " bytes, Active allocations: " << allocationCount << endl;
+        cout << "Memory Stats - Live: " << totalAllocated << " bytes in " << allocationCount 
+             << " allocations, Peak: " << peakAllocated << " bytes" << endl;
     }
 };
 
 size_t CustomAllocator::totalAllocated = 0;
+size_t CustomAllocator::peakAllocated = 0;
 size_t CustomAllocator::allocationCount = 0;
 
 class ManagedResource {
@@ -47,7 +524,7 @@ private:
     string name;
     
 public:
-    ManagedResource(const string& n, size_t s) : name(n), size(s) {
+    ManagedResource(const string& n, size_t s) : size(s), name(n) {
         data = static_cast<int*>(CustomAllocator::allocate(size * sizeof(int)));
         for (size_t i = 0; i < size; ++i) {
             data[i] = static_cast<int>(i * i);
@@ -84,7 +561,7 @@ public:
     }
 };
 
-class CircularReference {
+class CircularReference : public enable_shared_from_this<CircularReference> {
 public:
     shared_ptr<CircularReference> next;
     weak_ptr<CircularReference> parent;
@@ -106,7 +583,7 @@ public:
     }
 };
 
-class CircularReferenceDemo : public enable_shared_from_this<CircularReference> {
+class CircularReferenceDemo : public enable_shared_from_this<CircularReferenceDemo> {
 public:
     shared_ptr<CircularReferenceDemo> next;
     weak_ptr<CircularReferenceDemo> parent;
@@ -224,13 +701,108 @@ void performanceComparison() {
     cout << "Overhead: " << (smartTime.count() - rawTime.count()) << " μs" << endl;
 }
 
+// Allocation-heavy work typical of request handling: string building, a map
+// of small nodes and a growing vector, run on several threads.
+size_t allocationWorkload(int threads, int iterations) {
+    atomic<size_t> checksum{0};
+    vector<thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            for (int i = 0; i < iterations; ++i) {
+                unordered_map<string, vector<int>> index;
+                for (int k = 0; k < 256; ++k) {
+                    string key = "customer/" + to_string(t) + "/order/" + to_string(k * 7919 + i);
+                    auto& values = index[key];
+                    for (int v = 0; v < k % 8; ++v) {
+                        values.push_back(v * k);
+                    }
+                }
+                checksum += index.size();
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    return checksum;
+}
+
+void profilerDemo() {
+    cout << "\n=== Allocation Profiler ===" << endl;
+    
+#ifndef PROFILE_ALLOCATIONS
+    cout << "Build with -DPROFILE_ALLOCATIONS to route operator new through the profiler" << endl;
+#else
+    
+    const int threads = static_cast<int>(clamp(thread::hardware_concurrency(), 1u, 4u));
+    const int iterations = 500;
+    auto timeWorkload = [&] {
+        auto start = chrono::high_resolution_clock::now();
+        allocationWorkload(threads, iterations);
+        auto end = chrono::high_resolution_clock::now();
+        return chrono::duration<double, milli>(end - start).count();
+    };
+    
+    // Modes are interleaved and the best of several rounds kept, so drift in
+    // machine load does not land on a single mode.
+    double offMs = 1e18, exactMs = 1e18, sampledMs = 1e18;
+    for (int round = 0; round < 7; ++round) {
+        AllocationProfiler::disable();
+        offMs = min(offMs, timeWorkload());
+        AllocationProfiler::enable(1);
+        exactMs = min(exactMs, timeWorkload());
+        AllocationProfiler::enable();
+        sampledMs = min(sampledMs, timeWorkload());
+    }
+    
+    cout << "Workload without profiling: " << offMs << " ms" << endl;
+    cout << "Every allocation recorded:  " << exactMs << " ms (overhead " << (exactMs / offMs - 1.0) * 100 << "%)" << endl;
+    cout << "Sampled every ~" << AllocationProfiler::DEFAULT_SAMPLE_INTERVAL / 1024 << " KB:    " << sampledMs 
+         << " ms (overhead " << (sampledMs / offMs - 1.0) * 100 << "%)" << endl;
+    
+    // A cache that is still held when the report runs, so it shows up as live;
+    // exact mode guarantees it is seen. Freed afterwards to keep leak checkers quiet.
+    AllocationProfiler::enable(1);
+    auto* forgottenCache = new vector<int>(256, 7);
+    cout << "Holding a cache of " << forgottenCache->size() << " ints across the report" << endl;
+    
+    AllocationProfiler::report(cout, 5);
+    delete forgottenCache;
+    AllocationProfiler::enable();
+    
+    ostringstream folded;
+    AllocationProfiler::writeFoldedStacks(folded);
+    string line;
+    istringstream lines(folded.str());
+    cout << "Folded stacks (first 3 lines):" << endl;
+    for (int i = 0; i < 3 && getline(lines, line); ++i) {
+        cout << "  " << line.substr(0, 160) << endl;
+    }
+    
+    // Threads that come and go reuse the tables of threads that have exited.
+    size_t tablesBefore = AllocationProfiler::getThreadTableCount();
+    for (int round = 0; round < 50; ++round) {
+        allocationWorkload(4, 1);
+    }
+    cout << "Thread tables after 50 rounds of 4 short-lived threads: " 
+         << tablesBefore << " -> " << AllocationProfiler::getThreadTableCount() << endl;
+#endif
+}
+
 int main() {
     cout << "Advanced Memory Management Demo" << endl;
     cout << "===============================" << endl;
     
+#ifdef PROFILE_ALLOCATIONS
+    AllocationProfiler::enable();
+    // Set ALLOC_PROFILE_FOLDED=<file> to also get flamegraph input at exit.
+    AllocationProfiler::reportAtExit(getenv("ALLOC_PROFILE_FOLDED"));
+#endif
+    
     demonstrateSmartPointers();
     memoryLeakDemo();
     performanceComparison();
+    profilerDemo();
     
     cout << "\nFinal memory statistics:" << endl;
     CustomAllocator::printStats();